@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Load of 2.4GHz channels collected from scan results, used to pick the
+// channel of the captive AP. Kept free of Arduino headers to run on host.
+class ESPReactWifiChannels
+{
+public:
+    static const uint8_t maxChannel = 14;
+    static const uint8_t defaultChannel = 1;
+
+    ESPReactWifiChannels()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        memset(counts, 0, sizeof(counts));
+        memset(loads, 0, sizeof(loads));
+        hasData = false;
+    }
+
+    void add(int32_t channel, int32_t rssi)
+    {
+        if (channel < 1 || channel > maxChannel) {
+            return;
+        }
+        // every AP costs airtime, strong ones cost more
+        ++counts[channel];
+        loads[channel] += 10 + signalQuality(rssi);
+        hasData = true;
+    }
+
+    bool valid() const
+    {
+        return hasData;
+    }
+
+    uint8_t apCount(uint8_t channel) const
+    {
+        return channel <= maxChannel ? counts[channel] : 0;
+    }
+
+    uint32_t occupancy(uint8_t channel) const
+    {
+        return channel <= maxChannel ? loads[channel] : 0;
+    }
+
+    // one of 1, 6, 11, defaultChannel if nothing was scanned
+    uint8_t leastCongested() const
+    {
+        if (!hasData) {
+            return defaultChannel;
+        }
+        // 2.4GHz channels overlap with neighbours up to 4 channels away
+        static const uint8_t candidates[] = { 1, 6, 11 };
+        uint8_t best = candidates[0];
+        uint32_t bestLoad = UINT32_MAX;
+        uint32_t bestCount = UINT32_MAX;
+        for (uint8_t candidate : candidates) {
+            uint32_t load = 0;
+            uint32_t count = 0;
+            for (uint8_t channel = 1; channel <= maxChannel; channel++) {
+                int distance = abs(int(channel) - int(candidate));
+                if (distance < 5) {
+                    load += loads[channel] * (5 - distance) / 5;
+                    count += counts[channel];
+                }
+            }
+            if (load < bestLoad || (load == bestLoad && count < bestCount)) {
+                best = candidate;
+                bestLoad = load;
+                bestCount = count;
+            }
+        }
+        return best;
+    }
+
+    static int signalQuality(int32_t rssi)
+    {
+        if (rssi <= -100) {
+            return 0;
+        } else if (rssi >= -50) {
+            return 100;
+        } else {
+            return 2 * (rssi + 100);
+        }
+    }
+
+private:
+    uint8_t counts[maxChannel + 1];
+    uint32_t loads[maxChannel + 1];
+    bool hasData;
+};
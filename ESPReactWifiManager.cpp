@@ -21,6 +21,7 @@ typedef struct station_config sta_config_t;
 #else
 #include <WiFi.h>
 #include <SPIFFS.h>
+#include <Preferences.h>
 #include <esp_wifi.h>
 #include <esp_wpa2.h>
 
@@ -31,100 +32,588 @@ typedef wifi_sta_config_t sta_config_t;
 #define ENCRYPTION_ENT WIFI_AUTH_WPA2_ENTERPRISE
 #endif
 
-#include <Ticker.h>
 #include <DNSServer.h>
 #include <ESPAsyncWebServer.h>
+#include <lwip/etharp.h>
+#include <lwip/netif.h>
+#if defined(ESP32)
+#include <lwip/tcpip.h>
+#endif
 #include <algorithm>
-#include <memory>
 
 #define ARDUINOJSON_ENABLE_PROGMEM 1
 #include <ArduinoJson.h>
 #include <AsyncJson.h>
-#include <vector>
+
+#if ESPREACTWIFIMANAGER_LOGGING
+// log output is null when logging is disabled in the config
+#define WM_PRINT(...) do { if (features.log) features.log->print(__VA_ARGS__); } while (0)
+#define WM_PRINTLN(...) do { if (features.log) features.log->println(__VA_ARGS__); } while (0)
+#define WM_PRINTF(...) do { if (features.log) features.log->printf_P(__VA_ARGS__); } while (0)
+#define WM_FLUSH() do { if (features.log) features.log->flush(); } while (0)
+#else
+// messages are not compiled in
+#define WM_PRINT(...) do {} while (0)
+#define WM_PRINTLN(...) do {} while (0)
+#define WM_PRINTF(...) do {} while (0)
+#define WM_FLUSH() do {} while (0)
+#endif
 
 namespace {
 
-ESPReactWifiManager *instance = nullptr;
+const uint32_t reconnectInterval = 60 * 1000;
+const uint8_t retryLimit = 5;
+const float wifiReconnectDelay = 5;
 
-bool isConnecting = false;
-bool fallbackToAp = true;
+// Credentials are kept in our own record instead of the SDK station config:
+// it is rewritten only when a value changes and has no 64 byte limit.
+// On ESP32 the record is in NVS, out of reach of a web server serving files.
+// In a file a new copy is written next to the old one and renamed over it,
+// so power loss during a write leaves at least one of them valid.
+const char credentialsFile[] = "/wifi.cred";
+const char credentialsTempFile[] = "/wifi.cred.tmp";
+#if defined(ESP32)
+const char credentialsNamespace[] = "wifimanager";
+const char credentialsKey[] = "cred";
+#endif
+const uint32_t credentialsMagic = 0x57524d43; // "WRMC"
+const uint8_t credentialsVersion = 2; // 2 - added DHCP lease
 
-String connectSsid;
-String connectPassword;
-String connectLogin;
-String connectBssid;
+const uint32_t gatewayCheckDelay = 2000;
 
-String connectApName;
-String connectApPassword;
+bool signalLess(const ESPReactWifiManagerCore::WifiResult& a,
+                const ESPReactWifiManagerCore::WifiResult& b)
+{
+    return a.rssi > b.rssi;
+}
 
-uint32_t shouldScan = 0;
-uint32_t shouldConnect = 0;
+bool ssidEqual(const ESPReactWifiManagerCore::WifiResult& a,
+               const ESPReactWifiManagerCore::WifiResult& b)
+{
+    return a.ssid == b.ssid;
+}
 
-uint32_t reconnectInterval = 60 * 1000;
+bool ssidLess(const ESPReactWifiManagerCore::WifiResult& a,
+              const ESPReactWifiManagerCore::WifiResult& b)
+{
+    return a.ssid == b.ssid ? signalLess(a, b) : a.ssid < b.ssid;
+}
 
-DNSServer* dnsServer = nullptr;
-void (*finishedCallback)(bool) = nullptr;
-void (*notFoundCallback)(AsyncWebServerRequest*) = nullptr;
-bool (*captiveCallback)(AsyncWebServerRequest*) = nullptr;
+int32_t roundRssi(int32_t smoothedRssi)
+{
+    return smoothedRssi >= 0 ? (smoothedRssi + 8) / 16 : -((8 - smoothedRssi) / 16);
+}
 
-String wifiHostname;
+int str2mac(const char* mac, uint8_t* values){
+   if (6 == sscanf(mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5])) {
+       return 1;
+   } else {
+       return 0;
+   }
+}
 
-std::vector<ESPReactWifiManager::WifiResult> wifiResults;
-int wifiIndex = 0;
+uint32_t crc32(const uint8_t* data, size_t length)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
 
-Ticker wifiReconnectTimer;
+void appendValue(std::vector<uint8_t>& buffer, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++) {
+        buffer.push_back((value >> (8 * i)) & 0xff);
+    }
+}
 
-uint8_t retryCount = 0;
-uint8_t retryLimit = 5;
+uint32_t readValue(const uint8_t* data, uint8_t size)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        value |= uint32_t(data[i]) << (8 * i);
+    }
+    return value;
+}
 
-#if defined(ESP8266)
-WiFiEventHandler wifiConnectHandler;
-WiFiEventHandler wifiDisconnectHandler;
+void appendField(std::vector<uint8_t>& buffer, const String& value)
+{
+    appendValue(buffer, value.length(), 2);
+    buffer.insert(buffer.end(), value.c_str(), value.c_str() + value.length());
+}
+
+bool readField(const std::vector<uint8_t>& buffer, size_t& offset, size_t end, String& value)
+{
+    if (offset + 2 > end) {
+        return false;
+    }
+    size_t length = readValue(&buffer[offset], 2);
+    offset += 2;
+    if (offset + length > end) {
+        return false;
+    }
+    value = String();
+    value.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        value += static_cast<char>(buffer[offset + i]);
+    }
+    offset += length;
+    return true;
+}
+
+netif* stationNetif(uint32_t ip)
+{
+    for (netif* interface = netif_list; interface; interface = interface->next) {
+        if (ip4_addr_get_u32(netif_ip4_addr(interface)) == ip) {
+            return interface;
+        }
+    }
+    return nullptr;
+}
+
+size_t fillWifiList(const ESPReactWifiManagerCore::ResultsView& view, size_t& position,
+                    uint8_t* buffer, size_t maxLen, size_t index)
+{
+    if (index == 0) {
+        buffer[0] = '[';
+        if (view.empty()) {
+            buffer[1] = ']';
+            return 2;
+        }
+        return 1;
+    } else if (position >= view.size()) {
+        return 0;
+    } else {
+        const ESPReactWifiManagerCore::WifiResult& result = view[position];
+        String security;
+        if (result.encryptionType == ENCRYPTION_NONE) {
+            security = F("none");
+        } else if (result.encryptionType == ENCRYPTION_ENT) {
+            security = F("WPA2");
+        } else {
+            security = F("WEP");
+        }
+        const size_t capacity = JSON_OBJECT_SIZE(3) + 31 // fields length
+                                + security.length()
+                                + result.ssid.length();
+        DynamicJsonDocument doc(capacity);
+        JsonObject obj = doc.to<JsonObject>();
+        obj[F("ssid")] = result.ssid;
+        obj[F("signalStrength")] = result.quality;
+        obj[F("security")] = security;
+        // separator or closing bracket takes the place of null terminator
+        if (measureJson(doc) + 1 > maxLen) {
+            return RESPONSE_TRY_AGAIN;
+        }
+        size_t len = serializeJson(doc, (char*)buffer, maxLen);
+        if ((position + 1) == view.size()) {
+            buffer[len] = ']';
+        } else {
+            buffer[len] = ',';
+        }
+        ++len;
+        ++position;
+        return len;
+    }
+}
+
+} // namespace
+
+void ESPReactWifiManagerCore::mergeScanResult(const WifiResult& result)
+{
+    for (ScanEntry& entry : scanTable) {
+        if (memcmp(entry.result.bssid, result.bssid, sizeof(result.bssid)) != 0) {
+            continue;
+        }
+        // smooth rssi so a single noisy reading does not reorder the list,
+        // fixed point keeps steady readings from sticking up to 3 dBm away
+        entry.smoothedRssi += (result.rssi * 16 - entry.smoothedRssi) / 4;
+        entry.result = result;
+        entry.result.rssi = roundRssi(entry.smoothedRssi);
+        return;
+    }
+    ScanEntry entry = { result, result.rssi * 16 };
+    scanTable.push_back(entry);
+}
+
+void ESPReactWifiManagerCore::expireScanResults(uint32_t now)
+{
+    scanTable.erase(std::remove_if(scanTable.begin(), scanTable.end(),
+        [this, now](const ScanEntry& entry) {
+            return now - entry.result.lastSeen > scanMaxAge;
+        }), scanTable.end());
+}
+
+void ESPReactWifiManagerCore::updateResults()
+{
+    std::vector<ESPReactWifiManagerCore::WifiResult> results;
+    results.reserve(scanTable.size());
+
+    channelStats.reset();
+    for (const ScanEntry& scanEntry : scanTable) {
+        const ESPReactWifiManagerCore::WifiResult& entry = scanEntry.result;
+        // hidden networks are not listed but still occupy the channel
+        channelStats.add(entry.channel, entry.rssi);
+
+        if (entry.ssid.length() > 0) {
+            results.push_back(entry);
+            results.back().quality = ESPReactWifiChannels::signalQuality(entry.rssi);
+        }
+    }
+
+    if (features.dedupResults) {
+        features.dedupResults(results);
+    }
+    sort(results.begin(), results.end(), signalLess);
+
+    std::shared_ptr<const ESPReactWifiManagerCore::ResultsSnapshot> current = std::atomic_load(&wifiResults);
+    bool changed = results.size() != current->results.size();
+    for (size_t i = 0; !changed && i < results.size(); i++) {
+        changed = results[i].ssid != current->results[i].ssid;
+    }
+
+    std::shared_ptr<ESPReactWifiManagerCore::ResultsSnapshot> snapshot =
+            std::make_shared<ESPReactWifiManagerCore::ResultsSnapshot>();
+    snapshot->results.swap(results);
+    snapshot->generation = current->generation + (changed ? 1 : 0);
+    std::atomic_store(&wifiResults,
+                      std::shared_ptr<const ESPReactWifiManagerCore::ResultsSnapshot>(snapshot));
+}
+
+bool ESPReactWifiManagerCore::StoredCredentials::operator==(const StoredCredentials& other) const
+{
+    return ssid == other.ssid && password == other.password
+            && login == other.login && bssid == other.bssid
+            && lease.ssid == other.lease.ssid && lease.bssid == other.lease.bssid
+            && lease.ip == other.lease.ip && lease.gateway == other.lease.gateway
+            && lease.subnet == other.lease.subnet
+            && lease.dns1 == other.lease.dns1 && lease.dns2 == other.lease.dns2;
+}
+
+fs::FS& ESPReactWifiManagerCore::credentialsFileSystem()
+{
+    if (credentialsFs) {
+        return *credentialsFs;
+    }
+    // deprecated on ESP8266, kept as default for existing applications
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    return SPIFFS;
+#pragma GCC diagnostic pop
+}
+
+bool ESPReactWifiManagerCore::readCredentialsFile(const char* path, StoredCredentials& credentials)
+{
+    File file = credentialsFileSystem().open(path, "r");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> buffer(file.size());
+    size_t length = file.read(buffer.data(), buffer.size());
+    file.close();
+    if (length != buffer.size()) {
+        WM_PRINTF(PSTR("Error reading stored credentials: %s\n"), path);
+        return false;
+    }
+    return parseCredentials(buffer, path, credentials);
+}
+
+bool ESPReactWifiManagerCore::parseCredentials(const std::vector<uint8_t>& buffer, const char* source,
+                                               StoredCredentials& credentials)
+{
+    (void)source; // only in log messages
+    size_t length = buffer.size();
+    // magic + version + four length prefixes + crc
+    if (length < 4 + 1 + 4 * 2 + 4) {
+        WM_PRINTF(PSTR("Stored credentials are truncated: %s\n"), source);
+        return false;
+    }
+    size_t end = length - 4;
+    if (readValue(&buffer[end], 4) != crc32(buffer.data(), end)) {
+        WM_PRINTF(PSTR("Stored credentials checksum mismatch: %s\n"), source);
+        return false;
+    }
+    uint8_t version = buffer[4];
+    if (readValue(&buffer[0], 4) != credentialsMagic || version < 1 || version > credentialsVersion) {
+        WM_PRINTF(PSTR("Stored credentials have unknown format: %s\n"), source);
+        return false;
+    }
+
+    size_t offset = 5;
+    if (!readField(buffer, offset, end, credentials.ssid)
+            || !readField(buffer, offset, end, credentials.password)
+            || !readField(buffer, offset, end, credentials.login)
+            || !readField(buffer, offset, end, credentials.bssid)) {
+        WM_PRINTF(PSTR("Stored credentials are corrupted: %s\n"), source);
+        return false;
+    }
+    if (version >= 2) {
+        StoredLease& lease = credentials.lease;
+        if (!readField(buffer, offset, end, lease.ssid)
+                || !readField(buffer, offset, end, lease.bssid)
+                || offset + 5 * 4 > end) {
+            WM_PRINTF(PSTR("Stored lease is corrupted: %s\n"), source);
+            return false;
+        }
+        lease.ip = readValue(&buffer[offset], 4);
+        lease.gateway = readValue(&buffer[offset + 4], 4);
+        lease.subnet = readValue(&buffer[offset + 8], 4);
+        lease.dns1 = readValue(&buffer[offset + 12], 4);
+        lease.dns2 = readValue(&buffer[offset + 16], 4);
+    }
+    return true;
+}
+
+bool ESPReactWifiManagerCore::loadCredentials()
+{
+    if (storedCredentialsLoaded) {
+        return storedCredentials.ssid.length() > 0;
+    }
+    storedCredentialsLoaded = true;
+    storedCredentials = StoredCredentials();
+
+    StoredCredentials credentials;
+#if defined(ESP32)
+    if (!credentialsFs) {
+        if (readCredentialsNvs(credentials)) {
+            storedCredentials = credentials;
+        }
+        return storedCredentials.ssid.length() > 0;
+    }
 #endif
+    if (readCredentialsFile(credentialsFile, credentials)) {
+        storedCredentials = credentials;
+    } else {
+        // interrupted save, the new file was written but not renamed yet
+        credentials = StoredCredentials();
+        if (readCredentialsFile(credentialsTempFile, credentials)) {
+            WM_PRINTLN(F("Using credentials from unfinished save"));
+            storedCredentials = credentials;
+        }
+    }
+    return storedCredentials.ssid.length() > 0;
+}
 
-const float wifiReconnectDelay = 5;
+bool ESPReactWifiManagerCore::saveCredentials(const StoredCredentials& credentials)
+{
+    loadCredentials();
+    if (storedCredentials == credentials) {
+        return true;
+    }
+
+    const StoredLease& lease = credentials.lease;
+    std::vector<uint8_t> buffer;
+    buffer.reserve(4 + 1 + 6 * 2 + credentials.ssid.length() + credentials.password.length()
+                   + credentials.login.length() + credentials.bssid.length()
+                   + lease.ssid.length() + lease.bssid.length() + 5 * 4 + 4);
+    appendValue(buffer, credentialsMagic, 4);
+    buffer.push_back(credentialsVersion);
+    appendField(buffer, credentials.ssid);
+    appendField(buffer, credentials.password);
+    appendField(buffer, credentials.login);
+    appendField(buffer, credentials.bssid);
+    appendField(buffer, lease.ssid);
+    appendField(buffer, lease.bssid);
+    appendValue(buffer, lease.ip, 4);
+    appendValue(buffer, lease.gateway, 4);
+    appendValue(buffer, lease.subnet, 4);
+    appendValue(buffer, lease.dns1, 4);
+    appendValue(buffer, lease.dns2, 4);
+    appendValue(buffer, crc32(buffer.data(), buffer.size()), 4);
+
+#if defined(ESP32)
+    bool saved = credentialsFs ? writeCredentialsFile(buffer) : writeCredentialsNvs(buffer);
+#else
+    bool saved = writeCredentialsFile(buffer);
+#endif
+    if (!saved) {
+        return false;
+    }
+
+    storedCredentials = credentials;
+    WM_PRINTF(PSTR("Credentials saved, writes: %u\n"), credentialWriteCount);
+    return true;
+}
 
-bool signalLess(const ESPReactWifiManager::WifiResult& a,
-                const ESPReactWifiManager::WifiResult& b)
+bool ESPReactWifiManagerCore::writeCredentialsFile(const std::vector<uint8_t>& buffer)
 {
-    return a.rssi > b.rssi;
+    fs::FS& fileSystem = credentialsFileSystem();
+    File file = fileSystem.open(credentialsTempFile, "w");
+    if (!file) {
+        WM_PRINTLN(F("Error opening credentials file"));
+        return false;
+    }
+    size_t written = file.write(buffer.data(), buffer.size());
+    file.close();
+    ++credentialWriteCount;
+    if (written != buffer.size()) {
+        WM_PRINTLN(F("Error writing credentials file"));
+        fileSystem.remove(credentialsTempFile);
+        return false;
+    }
+
+    // SPIFFS rename does not replace an existing file
+    fileSystem.remove(credentialsFile);
+    if (!fileSystem.rename(credentialsTempFile, credentialsFile)) {
+        // loadCredentials() still finds the temporary file
+        WM_PRINTLN(F("Error renaming credentials file"));
+    }
+
+    return true;
 }
 
-bool ssidEqual(const ESPReactWifiManager::WifiResult& a,
-               const ESPReactWifiManager::WifiResult& b)
+#if defined(ESP32)
+bool ESPReactWifiManagerCore::readCredentialsNvs(StoredCredentials& credentials)
 {
-    return a.ssid == b.ssid;
+    Preferences preferences;
+    // read only open fails until the namespace is first written
+    if (!preferences.begin(credentialsNamespace, true)) {
+        return false;
+    }
+    std::vector<uint8_t> buffer(preferences.getBytesLength(credentialsKey));
+    size_t length = buffer.empty() ? 0 : preferences.getBytes(credentialsKey, buffer.data(), buffer.size());
+    preferences.end();
+    return length > 0 && length == buffer.size()
+            && parseCredentials(buffer, credentialsKey, credentials);
 }
 
-bool ssidLess(const ESPReactWifiManager::WifiResult& a,
-              const ESPReactWifiManager::WifiResult& b)
+// NVS replaces the value as a whole, no temporary copy is needed
+bool ESPReactWifiManagerCore::writeCredentialsNvs(const std::vector<uint8_t>& buffer)
 {
-    return a.ssid == b.ssid ? signalLess(a, b) : a.ssid < b.ssid;
+    Preferences preferences;
+    if (!preferences.begin(credentialsNamespace, false)) {
+        WM_PRINTLN(F("Error opening credentials in NVS"));
+        return false;
+    }
+    size_t written = preferences.putBytes(credentialsKey, buffer.data(), buffer.size());
+    preferences.end();
+    ++credentialWriteCount;
+    if (written != buffer.size()) {
+        WM_PRINTLN(F("Error writing credentials to NVS"));
+        return false;
+    }
+    return true;
 }
+#endif
 
-int str2mac(const char* mac, uint8_t* values){
-   if (6 == sscanf(mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &values[0], &values[1], &values[2], &values[3], &values[4], &values[5])) {
-       return 1;
-   } else {
-       return 0;
-   }
+bool ESPReactWifiManagerCore::saveCredentials(const String& ssid, const String& password,
+                                              const String& login, const String& bssid)
+{
+    loadCredentials();
+    StoredCredentials credentials = storedCredentials;
+    credentials.ssid = ssid;
+    credentials.password = password;
+    credentials.login = login;
+    credentials.bssid = bssid;
+    return saveCredentials(credentials);
+}
+
+void ESPReactWifiManagerCore::saveLease(const StoredLease& lease)
+{
+    loadCredentials();
+    StoredCredentials credentials = storedCredentials;
+    credentials.lease = lease;
+    saveCredentials(credentials);
+}
+
+bool ESPReactWifiManagerCore::canReuseLease()
+{
+    const StoredLease& lease = storedCredentials.lease;
+    return leaseReuse && lease.ip != 0 && lease.ssid == connectSsid
+            && (connectBssid.length() == 0 || connectBssid.equalsIgnoreCase(lease.bssid));
+}
+
+// Applied before WiFi.begin(), so with a reused lease or static address
+// got IP follows association without waiting for DHCP.
+void ESPReactWifiManagerCore::configureIp()
+{
+    leaseApplied = false;
+    shouldCheckGateway = 0;
+    arpCheckPending = false;
+    if (uint32_t(staticIp) != 0) {
+        WM_PRINT(F("Using static IP: "));
+        WM_PRINTLN(staticIp);
+        WiFi.config(staticIp, staticGateway, staticSubnet, staticDns1, staticDns2);
+        ipConfigured = true;
+    } else if (canReuseLease()) {
+        const StoredLease& lease = storedCredentials.lease;
+        WM_PRINT(F("Reusing DHCP lease: "));
+        WM_PRINTLN(IPAddress(lease.ip));
+        WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet),
+                    IPAddress(lease.dns1), IPAddress(lease.dns2));
+        ipConfigured = true;
+        leaseApplied = true;
+    } else if (ipConfigured) {
+        // zero address switches back to DHCP
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+        ipConfigured = false;
+    }
+}
+
+void ESPReactWifiManagerCore::runInTcpip(void (*func)(void*))
+{
+#if defined(ESP32)
+    if (tcpip_callback(func, this) != ERR_OK) {
+        WM_PRINTLN(F("Error queueing ARP request"));
+    }
+#else
+    func(this);
+#endif
+}
+
+// Asks for the gateway, and for our own address: the lease is not renewed
+// with the DHCP server, any answer for it means another host took it.
+void ESPReactWifiManagerCore::sendArpProbes(void* manager)
+{
+    ArpCheck& arpCheck = static_cast<ESPReactWifiManagerCore*>(manager)->arpCheck;
+    netif* interface = stationNetif(arpCheck.ip);
+    if (!interface) {
+        return;
+    }
+    ip4_addr_t address;
+    ip4_addr_set_u32(&address, arpCheck.gateway);
+    etharp_request(interface, &address);
+    ip4_addr_set_u32(&address, arpCheck.ip);
+    etharp_request(interface, &address);
+}
+
+void ESPReactWifiManagerCore::checkArpAnswers(void* manager)
+{
+    ArpCheck& arpCheck = static_cast<ESPReactWifiManagerCore*>(manager)->arpCheck;
+    netif* interface = stationNetif(arpCheck.ip);
+    arpCheck.gatewayFound = false;
+    arpCheck.addressTaken = false;
+    if (interface) {
+        ip4_addr_t address;
+        struct eth_addr* ethAddr = nullptr;
+        const ip4_addr_t* ipAddr = nullptr;
+        ip4_addr_set_u32(&address, arpCheck.gateway);
+        arpCheck.gatewayFound = etharp_find_addr(interface, &address, &ethAddr, &ipAddr) >= 0;
+        ip4_addr_set_u32(&address, arpCheck.ip);
+        arpCheck.addressTaken = etharp_find_addr(interface, &address, &ethAddr, &ipAddr) >= 0;
+    }
+    arpCheck.done = true;
 }
 
-void notFoundHandler(AsyncWebServerRequest* request)
+void ESPReactWifiManagerCore::notFound(AsyncWebServerRequest* request)
 {
     if (request->url().endsWith(F(".map"))) {
         request->send(404);
         return;
     }
 
-    Serial.print(F("Not found: "));
-    Serial.println(request->url());
+    WM_PRINT(F("Not found: "));
+    WM_PRINTLN(request->url());
 
-    Serial.print(F("Request: "));
-    Serial.println(request->client()->localIP());
+    WM_PRINT(F("Request: "));
+    WM_PRINTLN(request->client()->localIP());
 
-    Serial.print(F("Local: "));
-    Serial.println(WiFi.localIP());
+    WM_PRINT(F("Local: "));
+    WM_PRINTLN(WiFi.localIP());
 
     bool isLocal = WiFi.localIP() == request->client()->localIP();
 
@@ -133,13 +622,13 @@ void notFoundHandler(AsyncWebServerRequest* request)
     }
 
     if (!isLocal) {
-        Serial.print(F("Request redirected to captive portal: "));
-        Serial.println(request->url());
+        WM_PRINT(F("Request redirected to captive portal: "));
+        WM_PRINTLN(request->url());
         String redirect = String(F("http://"))
                 + request->client()->localIP().toString()
                 + String(F("/wifi.html"));
-        Serial.print(F("To: "));
-        Serial.println(redirect);
+        WM_PRINT(F("To: "));
+        WM_PRINTLN(redirect);
 
         request->redirect(redirect);
         return;
@@ -150,160 +639,165 @@ void notFoundHandler(AsyncWebServerRequest* request)
     }
 }
 
-void connectToWifi()
+void ESPReactWifiManagerCore::reconnect(ESPReactWifiManagerCore* manager)
 {
-    if (!instance) {
-        return;
-    }
-
-    instance->connect();
+    manager->connect();
 }
 
-void setupAP() {
+void ESPReactWifiManagerCore::setupAP()
+{
     bool success = WiFi.softAPConfig(
         IPAddress(8, 8, 8, 8),
         IPAddress(8, 8, 8, 8),
         IPAddress(255, 255, 255, 0));
     if (!success) {
-        Serial.println(F("Error setting static IP for AP mode"));
+        WM_PRINTLN(F("Error setting static IP for AP mode"));
         ESP.restart();
         return;
     }
 }
 
-void checkRetryCount() {
+void ESPReactWifiManagerCore::checkRetryCount()
+{
     if (isConnecting || WiFi.softAPgetStationNum() > 0) {
         return;
     }
 
     if (++retryCount <= retryLimit || !fallbackToAp) {
-        wifiReconnectTimer.once(wifiReconnectDelay, connectToWifi);
+        if (retryCount == retryLimit && fallbackToAp && apChannel == 0) {
+            // fresh channel data for startAP(), scanned from loop()
+            scheduleScan(0);
+        }
+        wifiReconnectTimer.once(wifiReconnectDelay, reconnect, this);
     } else {
         shouldConnect = millis() + reconnectInterval;
-        instance->startAP();
+        startAP();
     }
 }
 
 #if defined(ESP32)
-void WiFiEvent(WiFiEvent_t event) {
-    Serial.print("[WiFi-event] event: ");
+const char* ESPReactWifiManagerCore::eventName(int event)
+{
     switch(event) {
-
     case SYSTEM_EVENT_WIFI_READY:
-        Serial.println("SYSTEM_EVENT_WIFI_READY");
-        break;
+        return PSTR("SYSTEM_EVENT_WIFI_READY");
     case SYSTEM_EVENT_SCAN_DONE:
-        Serial.println("SYSTEM_EVENT_SCAN_DONE");
-        break;
+        return PSTR("SYSTEM_EVENT_SCAN_DONE");
     case SYSTEM_EVENT_STA_START:
-        Serial.println("SYSTEM_EVENT_STA_START");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_START");
     case SYSTEM_EVENT_STA_STOP:
-        Serial.println("SYSTEM_EVENT_STA_STOP");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_STOP");
     case SYSTEM_EVENT_STA_CONNECTED:
-        Serial.println("SYSTEM_EVENT_STA_CONNECTED");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_CONNECTED");
     case SYSTEM_EVENT_STA_DISCONNECTED:
-        Serial.println("SYSTEM_EVENT_STA_DISCONNECTED");
-        checkRetryCount();
-        break;
+        return PSTR("SYSTEM_EVENT_STA_DISCONNECTED");
     case SYSTEM_EVENT_STA_AUTHMODE_CHANGE:
-        Serial.println("SYSTEM_EVENT_STA_AUTHMODE_CHANGE");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_AUTHMODE_CHANGE");
     case SYSTEM_EVENT_STA_GOT_IP:
-        Serial.println("SYSTEM_EVENT_STA_GOT_IP");
-        instance->finishConnection(false);
-        break;
+        return PSTR("SYSTEM_EVENT_STA_GOT_IP");
     case SYSTEM_EVENT_STA_LOST_IP:
-        Serial.println("SYSTEM_EVENT_STA_LOST_IP");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_LOST_IP");
     case SYSTEM_EVENT_STA_WPS_ER_SUCCESS:
-        Serial.println("SYSTEM_EVENT_STA_WPS_ER_SUCCESS");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_WPS_ER_SUCCESS");
     case SYSTEM_EVENT_STA_WPS_ER_FAILED:
-        Serial.println("SYSTEM_EVENT_STA_WPS_ER_FAILED");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_WPS_ER_FAILED");
     case SYSTEM_EVENT_STA_WPS_ER_TIMEOUT:
-        Serial.println("SYSTEM_EVENT_STA_WPS_ER_TIMEOUT");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_WPS_ER_TIMEOUT");
     case SYSTEM_EVENT_STA_WPS_ER_PIN:
-        Serial.println("SYSTEM_EVENT_STA_WPS_ER_PIN");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_WPS_ER_PIN");
     case SYSTEM_EVENT_STA_WPS_ER_PBC_OVERLAP:
-        Serial.println("SYSTEM_EVENT_STA_WPS_ER_PBC_OVERLAP");
-        break;
+        return PSTR("SYSTEM_EVENT_STA_WPS_ER_PBC_OVERLAP");
     case SYSTEM_EVENT_AP_START:
-        Serial.println("SYSTEM_EVENT_AP_START");
-        break;
+        return PSTR("SYSTEM_EVENT_AP_START");
     case SYSTEM_EVENT_AP_STOP:
-        Serial.println("SYSTEM_EVENT_AP_STOP");
-        break;
+        return PSTR("SYSTEM_EVENT_AP_STOP");
     case SYSTEM_EVENT_AP_STACONNECTED:
-        Serial.println("SYSTEM_EVENT_AP_STACONNECTED");
-        instance->scheduleScan(200);
-        break;
+        return PSTR("SYSTEM_EVENT_AP_STACONNECTED");
     case SYSTEM_EVENT_AP_STADISCONNECTED:
-        Serial.println("SYSTEM_EVENT_AP_STADISCONNECTED");
-        break;
+        return PSTR("SYSTEM_EVENT_AP_STADISCONNECTED");
     case SYSTEM_EVENT_AP_STAIPASSIGNED:
-        Serial.println("SYSTEM_EVENT_AP_STAIPASSIGNED");
-        break;
+        return PSTR("SYSTEM_EVENT_AP_STAIPASSIGNED");
     case SYSTEM_EVENT_AP_PROBEREQRECVED:
-        Serial.println("SYSTEM_EVENT_AP_PROBEREQRECVED");
-        break;
+        return PSTR("SYSTEM_EVENT_AP_PROBEREQRECVED");
     case SYSTEM_EVENT_GOT_IP6:
-        Serial.println("SYSTEM_EVENT_GOT_IP6");
-        break;
+        return PSTR("SYSTEM_EVENT_GOT_IP6");
     case SYSTEM_EVENT_ETH_START:
-        Serial.println("SYSTEM_EVENT_ETH_START");
-        break;
+        return PSTR("SYSTEM_EVENT_ETH_START");
     case SYSTEM_EVENT_ETH_STOP:
-        Serial.println("SYSTEM_EVENT_ETH_STOP");
-        break;
+        return PSTR("SYSTEM_EVENT_ETH_STOP");
     case SYSTEM_EVENT_ETH_CONNECTED:
-        Serial.println("SYSTEM_EVENT_ETH_CONNECTED");
-        break;
+        return PSTR("SYSTEM_EVENT_ETH_CONNECTED");
     case SYSTEM_EVENT_ETH_DISCONNECTED:
-        Serial.println("SYSTEM_EVENT_ETH_DISCONNECTED");
-        break;
+        return PSTR("SYSTEM_EVENT_ETH_DISCONNECTED");
     case SYSTEM_EVENT_ETH_GOT_IP:
-        Serial.println("SYSTEM_EVENT_ETH_GOT_IP");
-        break;
+        return PSTR("SYSTEM_EVENT_ETH_GOT_IP");
     case SYSTEM_EVENT_MAX:
-        Serial.println("SYSTEM_EVENT_MAX");
-        break;
+        return PSTR("SYSTEM_EVENT_MAX");
+    default:
+        return PSTR("UNKNOWN");
     }
 }
-#else
-void onWifiConnect(const WiFiEventStationModeGotIP& event) {
-    Serial.println("Connected to Wi-Fi.");
-    instance->finishConnection(false);
-}
 
-void onWifiDisconnect(const WiFiEventStationModeDisconnected& event) {
-    Serial.println("Disconnected from Wi-Fi.");
-    checkRetryCount();
+void ESPReactWifiManagerCore::onWifiEvent(int event)
+{
+    if (features.eventName) {
+        WM_PRINT("[WiFi-event] event: ");
+        WM_PRINTLN(features.eventName(event));
+    }
+    switch(event) {
+    case SYSTEM_EVENT_STA_DISCONNECTED:
+        checkRetryCount();
+        break;
+    case SYSTEM_EVENT_STA_GOT_IP:
+        finishConnection(false);
+        break;
+    case SYSTEM_EVENT_AP_STACONNECTED:
+        scheduleScan(200);
+        break;
+    default:
+        break;
+    }
 }
 #endif
-}
 
-ESPReactWifiManager::ESPReactWifiManager()
+ESPReactWifiManagerCore::ESPReactWifiManagerCore(const Features& selected)
+    : features(selected)
+    , wifiResults(std::make_shared<ResultsSnapshot>())
 {
-    instance = this;
+    arpCheck.done = false;
+    shouldSaveLease = false;
 
 #if defined(ESP8266)
-    wifiConnectHandler = WiFi.onStationModeGotIP(onWifiConnect);
-    wifiDisconnectHandler = WiFi.onStationModeDisconnected(onWifiDisconnect);
+    wifiConnectHandler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP&) {
+        WM_PRINTLN("Connected to Wi-Fi.");
+        finishConnection(false);
+    });
+    wifiDisconnectHandler = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected&) {
+        WM_PRINTLN("Disconnected from Wi-Fi.");
+        checkRetryCount();
+    });
 #else
-    WiFi.onEvent(WiFiEvent);
+    wifiEventId = WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t) {
+        onWifiEvent(event);
+    });
 #endif
 }
 
-void ESPReactWifiManager::loop()
+ESPReactWifiManagerCore::~ESPReactWifiManagerCore()
 {
-    if (dnsServer) {
-        dnsServer->processNextRequest();
+#if defined(ESP32)
+    WiFi.removeEvent(wifiEventId);
+#endif
+    wifiReconnectTimer.detach();
+    if (features.captiveDns) {
+        features.captiveDns(*this, false);
+    }
+}
+
+void ESPReactWifiManagerCore::loop()
+{
+    if (features.captiveDnsLoop) {
+        features.captiveDnsLoop(*this);
     }
 
     uint32_t now = millis();
@@ -314,13 +808,36 @@ void ESPReactWifiManager::loop()
         scan();
     }
 
+    if (shouldSaveLease) {
+        saveLease(gotLease);
+        shouldSaveLease = false;
+    }
+
+    if (shouldCheckGateway > 0 && now > shouldCheckGateway) {
+        shouldCheckGateway = 0;
+        arpCheckPending = true;
+        arpCheck.done = false;
+        runInTcpip(checkArpAnswers);
+    }
+
+    if (arpCheckPending && arpCheck.done) {
+        arpCheckPending = false;
+        if (!arpCheck.gatewayFound || arpCheck.addressTaken) {
+            WM_PRINTLN(arpCheck.addressTaken
+                    ? F("Reused address is taken, falling back to DHCP")
+                    : F("Gateway does not answer, falling back to DHCP"));
+            saveLease(StoredLease());
+            connect();
+        }
+    }
+
     if (WiFi.status() != WL_CONNECTED && now > shouldConnect && shouldConnect > 0) {
         shouldConnect = 0;
         connect();
     }
 }
 
-void ESPReactWifiManager::disconnect()
+void ESPReactWifiManagerCore::disconnect()
 {
     WiFi.softAPdisconnect(true);
 #if defined(ESP8266)
@@ -333,13 +850,13 @@ void ESPReactWifiManager::disconnect()
 #endif
 }
 
-void ESPReactWifiManager::setApOptions(String apName, String apPassword)
+void ESPReactWifiManagerCore::setApOptions(String apName, String apPassword)
 {
     connectApName = apName;
     connectApPassword = apPassword;
 }
 
-void ESPReactWifiManager::setStaOptions(String ssid, String password, String login, String bssid)
+void ESPReactWifiManagerCore::setStaOptions(String ssid, String password, String login, String bssid)
 {
     connectSsid = ssid;
     connectPassword = password;
@@ -347,9 +864,9 @@ void ESPReactWifiManager::setStaOptions(String ssid, String password, String log
     connectBssid = bssid;
 }
 
-bool ESPReactWifiManager::connect()
+bool ESPReactWifiManagerCore::connect()
 {
-    Serial.println();
+    WM_PRINTLN();
 
     isConnecting = true;
     disconnect();
@@ -364,7 +881,16 @@ bool ESPReactWifiManager::connect()
 #endif
     }
 
+    if (connectSsid.length() == 0 && loadCredentials()) {
+        WM_PRINTLN(F("Connecting to last saved network"));
+        connectSsid = storedCredentials.ssid;
+        connectPassword = storedCredentials.password;
+        connectLogin = storedCredentials.login;
+        connectBssid = storedCredentials.bssid;
+    }
+
     if (connectSsid.length() == 0) {
+        // migrate network saved by the SDK before the credentials file existed
         sta_config_t sta_conf;
 #if defined(ESP32)
         wifi_config_t current_conf;
@@ -376,6 +902,7 @@ bool ESPReactWifiManager::connect()
         connectSsid = String(reinterpret_cast<const char*>(sta_conf.ssid));
 
         if (connectSsid.length() == 0) {
+            WM_PRINTLN(F("No last saved network"));
             isConnecting = false;
             return false;
         }
@@ -390,88 +917,109 @@ bool ESPReactWifiManager::connect()
             connectPassword = savedPassword;
         }
 
-        if (connectSsid.length() > 0) {
-            Serial.println(F("Connecting to last saved network"));
-        } else {
-            Serial.println(F("No last saved network"));
-            isConnecting = false;
-            return false;
-        }
+        WM_PRINTLN(F("Connecting to network saved by SDK"));
     }
 
-    String tempPassword = connectPassword;
+    credentialsSaveFailed = !saveCredentials(connectSsid, connectPassword, connectLogin, connectBssid);
+    // SDK writes the station config on every WiFi.begin(), it is only
+    // needed when our own record could not be saved, e.g. file system not mounted
+    WiFi.persistent(credentialsSaveFailed);
+    if (credentialsSaveFailed) {
+        WM_PRINTLN(F("Error saving credentials, SDK persistence is used instead"));
+    }
+
+    const char* passphrase = connectPassword.c_str();
     if (connectLogin.length() == 0) {
-        Serial.print(F("Connecting to network: "));
-        Serial.println(connectSsid);
-        Serial.flush();
+        WM_PRINT(F("Connecting to network: "));
+        WM_PRINTLN(connectSsid);
+        WM_FLUSH();
     } else {
-        Serial.print(F("Connecting to secure network: "));
-        Serial.println(connectSsid);
-        Serial.flush();
-        tempPassword = F("x:");
-        tempPassword += connectLogin;
-        tempPassword += F(":");
-        tempPassword += connectPassword;
-#if defined(ESP32)
-        esp_wifi_sta_wpa2_ent_enable();
-#else
-        wifi_station_set_wpa2_enterprise_auth(1);
-#endif
-        esp_wifi_sta_wpa2_ent_set_identity((wifi_cred_t*)connectLogin.c_str(), connectLogin.length());
-        esp_wifi_sta_wpa2_ent_set_username((wifi_cred_t*)connectLogin.c_str(), connectLogin.length());
-        esp_wifi_sta_wpa2_ent_set_password((wifi_cred_t*)connectPassword.c_str(), connectPassword.length());
+        WM_PRINT(F("Connecting to secure network: "));
+        WM_PRINTLN(connectSsid);
+        WM_FLUSH();
+        if (!features.enterpriseLogin) {
+            WM_PRINTLN(F("WPA2-Enterprise support is disabled"));
+            isConnecting = false;
+            return false;
+        }
+        // enterprise credentials go to the supplicant, not the station config
+        passphrase = nullptr;
+        features.enterpriseLogin(connectLogin, connectPassword);
     }
+    configureIp();
+
+    connectStarted = millis();
+    connectPending = true;
     uint8_t mac[6] = { 0 };
     if (connectBssid.length() > 0 && str2mac(connectBssid.c_str(), mac)) {
-        Serial.print(F("Pin to BSSID: "));
-        Serial.println(connectBssid);
-        WiFi.begin(connectSsid.c_str(), tempPassword.c_str(), 0, mac);
+        WM_PRINT(F("Pin to BSSID: "));
+        WM_PRINTLN(connectBssid);
+        WiFi.begin(connectSsid.c_str(), passphrase, 0, mac);
     } else {
-        WiFi.begin(connectSsid.c_str(), tempPassword.c_str());
+        WiFi.begin(connectSsid.c_str(), passphrase);
     }
 
-    Serial.println(F("Finished connecting"));
+    WM_PRINTLN(F("Finished connecting"));
     isConnecting = false;
     return true;
 }
 
-bool ESPReactWifiManager::autoConnect()
+bool ESPReactWifiManagerCore::autoConnect()
 {
-    return connect() || startAP();
+    if (connect()) {
+        return true;
+    }
+    if (apChannel == 0 && !channelStats.valid()) {
+        // fresh device has no scan data yet, autoConnect() runs from setup()
+        // where a blocking scan is fine, unlike startAP() from WiFi events
+        scan();
+    }
+    return startAP();
 }
 
-void ESPReactWifiManager::setFallbackToAp(bool enable)
+void ESPReactWifiManagerCore::setFallbackToAp(bool enable)
 {
     fallbackToAp = enable;
 }
 
-bool ESPReactWifiManager::startAP()
+bool ESPReactWifiManagerCore::startAP()
 {
-    Serial.println();
+    WM_PRINTLN();
     disconnect();
 
     bool success = WiFi.mode(WIFI_AP);
     if (!success) {
-        Serial.println(F("Error changing mode to AP"));
+        WM_PRINTLN(F("Error changing mode to AP"));
         ESP.restart();
         return false;
     }
 #if defined(ESP8266)
     setupAP();
 #endif
-    Serial.print(F("Starting AP: "));
-    Serial.println(connectApName);
-    success = WiFi.softAP(connectApName.c_str(), connectApPassword.c_str());
+    uint8_t channel = apChannel;
+    if (channel == 0) {
+        // no scan here, startAP() is called from WiFi event callbacks
+        channel = channelStats.leastCongested();
+    }
+    WM_PRINT(F("Starting AP: "));
+    WM_PRINT(connectApName);
+    WM_PRINT(F(" on channel "));
+    WM_PRINTLN(channel);
+    success = WiFi.softAP(connectApName.c_str(), connectApPassword.c_str(), channel);
     if (success) {
 #if defined(ESP32)
         delay(500);
         setupAP();
 #endif
-        instance->finishConnection(true);
+        finishConnection(true);
     } else {
-        WiFi.printDiag(Serial);
-        Serial.print(F("Error starting AP: "));
-        Serial.println(WiFi.status());
+#if ESPREACTWIFIMANAGER_LOGGING
+        if (features.log) {
+            WiFi.printDiag(*features.log);
+        }
+#endif
+        WM_PRINT(F("Error starting AP: "));
+        WM_PRINTLN(WiFi.status());
         ESP.restart();
         return false;
     }
@@ -480,15 +1028,20 @@ bool ESPReactWifiManager::startAP()
 }
 
 
-void ESPReactWifiManager::setupHandlers(AsyncWebServer *server)
+void ESPReactWifiManagerCore::setApChannel(uint8_t channel)
+{
+    apChannel = channel <= ESPReactWifiChannels::maxChannel ? channel : 0;
+}
+
+void ESPReactWifiManagerCore::setupHandlers(AsyncWebServer *server)
 {
     if (!server) {
-        Serial.println(F("WebServer is null!"));
+        WM_PRINTLN(F("WebServer is null!"));
         return;
     }
 
     server->on(PSTR("/wifiSave"), HTTP_POST, [this](AsyncWebServerRequest* request) {
-        Serial.println("wifiSave request");
+        WM_PRINTLN("wifiSave request");
 
         String login;
         String password;
@@ -520,92 +1073,87 @@ void ESPReactWifiManager::setupHandlers(AsyncWebServer *server)
         request->send(200, F("text/html"), message);
     });
 
-    server->on(PSTR("/wifiList"), HTTP_GET, [](AsyncWebServerRequest* request) {
-        wifiIndex = 0;
-        Serial.printf_P(PSTR("wifiList count: %zu\n"), wifiResults.size());
+    server->on(PSTR("/wifiList"), HTTP_GET, [this](AsyncWebServerRequest* request) {
+        ResultsView view = resultsView();
+        WM_PRINTF(PSTR("wifiList count: %zu\n"), view.size());
+        // position is per response, concurrent clients do not share it
+        size_t position = 0;
         AsyncWebServerResponse* response = request->beginChunkedResponse(
             F("application/json"),
-            [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
-                if (index == 0) {
-                    buffer[0] = '[';
-                    return 1;
-                } else if (wifiIndex >= wifiResults.size()) {
-                    return 0;
-                } else {
-                    String security;
-                    if (wifiResults[wifiIndex].encryptionType == ENCRYPTION_NONE) {
-                        security = F("none");
-                    } else if (wifiResults[wifiIndex].encryptionType == ENCRYPTION_ENT) {
-                        security = F("WPA2");
-                    } else {
-                        security = F("WEP");
-                    }
-                    const size_t capacity = JSON_OBJECT_SIZE(3) + 31 // fields length
-                                            + security.length()
-                                            + wifiResults[wifiIndex].ssid.length();
-                    DynamicJsonDocument doc(capacity);
-                    JsonObject obj = doc.to<JsonObject>();
-                    obj[F("ssid")] = wifiResults[wifiIndex].ssid;
-                    obj[F("signalStrength")] = wifiResults[wifiIndex].quality;
-                    obj[F("security")] = security;
-                    size_t len = serializeJson(doc, (char*)buffer, maxLen);
-                    if ((wifiIndex + 1) == wifiResults.size()) {
-                        buffer[len] = ']';
-                    } else {
-                        buffer[len] = ',';
-                    }
-                    ++len;
-                    ++wifiIndex;
-                    return len;
-                }
+            [view, position](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+                return fillWifiList(view, position, buffer, maxLen, index);
             });
         request->send(response);
     });
 
-    server->onNotFound(notFoundHandler);
+    server->onNotFound([this](AsyncWebServerRequest* request) {
+        notFound(request);
+    });
 }
 
-void ESPReactWifiManager::onFinished(void (*func)(bool))
+void ESPReactWifiManagerCore::onFinished(void (*func)(bool))
 {
     finishedCallback = func;
 }
 
-void ESPReactWifiManager::onNotFound(void (*func)(AsyncWebServerRequest*))
+void ESPReactWifiManagerCore::onNotFound(void (*func)(AsyncWebServerRequest*))
 {
     notFoundCallback = func;
 }
 
-void ESPReactWifiManager::onCaptiveRedirect(bool (*func)(AsyncWebServerRequest*))
+void ESPReactWifiManagerCore::onCaptiveRedirect(bool (*func)(AsyncWebServerRequest*))
 {
     captiveCallback = func;
 }
 
-void ESPReactWifiManager::finishConnection(bool apMode)
+void ESPReactWifiManagerCore::finishConnection(bool apMode)
 {
     if (apMode) {
-        Serial.println("AP started");
-        Serial.print(F("AP IP address: "));
-        Serial.println(WiFi.softAPIP());
+        WM_PRINTLN("AP started");
+        WM_PRINT(F("AP IP address: "));
+        WM_PRINTLN(WiFi.softAPIP());
     } else {
-        Serial.println("Connected to Wi-Fi.");
-        Serial.print(F("AP ssid: "));
-        Serial.println(WiFi.SSID());
-        Serial.print(F("AP bssid: "));
-        Serial.println(WiFi.BSSIDstr());
-        Serial.print(F("STA IP address: "));
-        Serial.println(WiFi.localIP());
+        WM_PRINTLN("Connected to Wi-Fi.");
+        WM_PRINT(F("AP ssid: "));
+        WM_PRINTLN(WiFi.SSID());
+        WM_PRINT(F("AP bssid: "));
+        WM_PRINTLN(WiFi.BSSIDstr());
+        WM_PRINT(F("STA IP address: "));
+        WM_PRINTLN(WiFi.localIP());
+
+        // got IP without connect() is SDK auto reconnect, not measured
+        if (connectPending) {
+            connectPending = false;
+            lastGotIpLatency = millis() - connectStarted;
+            WM_PRINTF(PSTR("Got IP in %u ms\n"), lastGotIpLatency);
+        }
+
+        if (leaseApplied) {
+            // make sure the reused address is still valid on this network
+            arpCheck.ip = WiFi.localIP();
+            arpCheck.gateway = WiFi.gatewayIP();
+            runInTcpip(sendArpProbes);
+            shouldCheckGateway = millis() + gatewayCheckDelay;
+        } else if (leaseReuse && !ipConfigured) {
+            StoredLease lease;
+            lease.ssid = WiFi.SSID();
+            lease.bssid = WiFi.BSSIDstr();
+            lease.ip = WiFi.localIP();
+            lease.gateway = WiFi.gatewayIP();
+            lease.subnet = WiFi.subnetMask();
+            lease.dns1 = WiFi.dnsIP(0);
+            lease.dns2 = WiFi.dnsIP(1);
+            // saved from loop(), file system and storedCredentials are not
+            // touched from WiFi event callbacks. Kept until loop() takes it.
+            if (!shouldSaveLease) {
+                gotLease = lease;
+                shouldSaveLease = true;
+            }
+        }
     }
 
-    if (!dnsServer && apMode) {
-        dnsServer = new DNSServer();
-        dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
-        bool dnsOk = dnsServer->start(53, F("*"), WiFi.softAPIP());
-        Serial.printf_P(PSTR("Starting DNS server: %s\n"), dnsOk ? PSTR("success") : PSTR("fail"));
-    } else if (dnsServer && !apMode) {
-        Serial.println(F("Stopping DNS server"));
-        dnsServer->stop();
-        delete dnsServer;
-        dnsServer = nullptr;
+    if (features.captiveDns) {
+        features.captiveDns(*this, apMode);
     }
 
 #if defined(ESP8266)
@@ -617,92 +1165,194 @@ void ESPReactWifiManager::finishConnection(bool apMode)
     }
 }
 
-void ESPReactWifiManager::scheduleScan(int timeout)
+void ESPReactWifiManagerCore::scheduleScan(int timeout)
 {
-    Serial.println(F("scheduleScan"));
+    WM_PRINTLN(F("scheduleScan"));
     shouldScan = millis() + timeout;
 }
 
-bool ESPReactWifiManager::scan()
+bool ESPReactWifiManagerCore::scan(uint8_t channel)
 {
-    wifi_ssid_count_t n = WiFi.scanNetworks();
-    Serial.println(F("Scan done"));
+#if defined(ESP8266)
+    wifi_ssid_count_t n = WiFi.scanNetworks(false, true, channel);
+#else
+    // channel limited scan is not exposed by the ESP32 core, scan all
+    (void)channel;
+    wifi_ssid_count_t n = WiFi.scanNetworks(false, true);
+#endif
+    WM_PRINTLN(F("Scan done"));
     if (n == WIFI_SCAN_FAILED) {
-        Serial.println(F("scanNetworks returned: WIFI_SCAN_FAILED!"));
+        WM_PRINTLN(F("scanNetworks returned: WIFI_SCAN_FAILED!"));
         return false;
     } else if (n == WIFI_SCAN_RUNNING) {
-        Serial.println(F("scanNetworks returned: WIFI_SCAN_RUNNING!"));
+        WM_PRINTLN(F("scanNetworks returned: WIFI_SCAN_RUNNING!"));
         return false;
     } else if (n < 0) {
-        Serial.print(F("scanNetworks failed with unknown error code: "));
-        Serial.println(n);
-        return false;
-    } else if (n == 0) {
-        Serial.println(F("No networks found"));
+        WM_PRINT(F("scanNetworks failed with unknown error code: "));
+        WM_PRINTLN(n);
         return false;
+    }
+
+    if (n == 0) {
+        WM_PRINTLN(F("No networks found"));
     } else {
-        Serial.print(F("Found networks: "));
-        Serial.println(n);
-        wifiResults.clear();
-        for (wifi_ssid_count_t i = 0; i < n; i++) {
-            WifiResult result;
-            bool res = WiFi.getNetworkInfo(i, result.ssid, result.encryptionType,
-                result.rssi, result.bssid, result.channel
+        WM_PRINT(F("Found networks: "));
+        WM_PRINTLN(n);
+    }
+
+    uint32_t now = millis();
+    for (wifi_ssid_count_t i = 0; i < n; i++) {
+        WifiResult result;
+        uint8_t* bssid = nullptr;
+        bool res = WiFi.getNetworkInfo(i, result.ssid, result.encryptionType,
+            result.rssi, bssid, result.channel
 #if defined(ESP8266)
-                ,
-                result.isHidden
+            ,
+            result.isHidden
 #endif
-            );
-
-            if (!res) {
-                Serial.printf_P(PSTR("Error getNetworkInfo for %d\n"), i);
-            } else {
-                if (result.ssid.length() == 0) {
-                    continue;
-                }
-
-                result.quality = 0;
-
-                if (result.rssi <= -100) {
-                    result.quality = 0;
-                } else if (result.rssi >= -50) {
-                    result.quality = 100;
-                } else {
-                    result.quality = 2 * (result.rssi + 100);
-                }
-
-                Serial.printf("index: %d\n", i);
-                Serial.printf("ssid: %s\n", result.ssid.c_str());
-                Serial.printf("bssid: %02X:%02X:%02X:%02X:%02X:%02X\n", result.bssid[0]
-                                                          , result.bssid[1]
-                                                          , result.bssid[2]
-                                                          , result.bssid[3]
-                                                          , result.bssid[4]
-                                                          , result.bssid[5]);
-
-                wifiResults.push_back(result);
-            }
+        );
+
+        if (!res || !bssid) {
+            WM_PRINTF(PSTR("Error getNetworkInfo for %d\n"), i);
+            continue;
         }
 
-        sort(wifiResults.begin(), wifiResults.end(), ssidLess);
-        wifiResults.erase(unique(wifiResults.begin(), wifiResults.end(), ssidEqual), wifiResults.end());
-        sort(wifiResults.begin(), wifiResults.end(), signalLess);
+        memcpy(result.bssid, bssid, sizeof(result.bssid));
+        result.lastSeen = now;
 
-        return true;
+        WM_PRINTF(PSTR("index: %d\n"), i);
+        WM_PRINTF(PSTR("ssid: %s\n"), result.ssid.c_str());
+        WM_PRINTF(PSTR("bssid: %02X:%02X:%02X:%02X:%02X:%02X\n"), result.bssid[0]
+                                                  , result.bssid[1]
+                                                  , result.bssid[2]
+                                                  , result.bssid[3]
+                                                  , result.bssid[4]
+                                                  , result.bssid[5]);
+
+        mergeScanResult(result);
     }
+    WiFi.scanDelete();
+
+    expireScanResults(now);
+    updateResults();
+
+    return n > 0;
 }
 
-int ESPReactWifiManager::size()
+int ESPReactWifiManagerCore::size()
 {
-    return wifiResults.size();
+    return resultCount();
 }
 
-void ESPReactWifiManager::setHostname(String hostname)
+size_t ESPReactWifiManagerCore::resultCount()
+{
+    return std::atomic_load(&wifiResults)->results.size();
+}
+
+void ESPReactWifiManagerCore::setHostname(String hostname)
 {
     wifiHostname = hostname;
 }
 
-std::vector<ESPReactWifiManager::WifiResult> ESPReactWifiManager::results()
+std::vector<ESPReactWifiManagerCore::WifiResult> ESPReactWifiManagerCore::results()
+{
+    return std::atomic_load(&wifiResults)->results;
+}
+
+ESPReactWifiManagerCore::ResultsView ESPReactWifiManagerCore::resultsView() const
+{
+    return ResultsView(std::atomic_load(&wifiResults));
+}
+
+uint32_t ESPReactWifiManagerCore::generation()
+{
+    return std::atomic_load(&wifiResults)->generation;
+}
+
+void ESPReactWifiManagerCore::setScanMaxAge(uint32_t maxAge)
+{
+    scanMaxAge = maxAge;
+}
+
+void ESPReactWifiManagerCore::setStaticIp(IPAddress ip, IPAddress gateway, IPAddress subnet,
+                                      IPAddress dns1, IPAddress dns2)
+{
+    staticIp = ip;
+    staticGateway = gateway;
+    staticSubnet = subnet;
+    staticDns1 = dns1;
+    staticDns2 = dns2;
+}
+
+void ESPReactWifiManagerCore::setLeaseReuse(bool enable)
+{
+    leaseReuse = enable;
+}
+
+uint32_t ESPReactWifiManagerCore::gotIpLatency()
+{
+    return lastGotIpLatency;
+}
+
+void ESPReactWifiManagerCore::setFileSystem(fs::FS& fileSystem)
+{
+    credentialsFs = &fileSystem;
+    storedCredentialsLoaded = false;
+}
+
+bool ESPReactWifiManagerCore::credentialsSaved()
+{
+    return !credentialsSaveFailed;
+}
+
+uint32_t ESPReactWifiManagerCore::credentialWrites()
+{
+    return credentialWriteCount;
+}
+
+void ESPReactWifiManagerCore::enterpriseLogin(const String& login, const String& password)
+{
+#if defined(ESP32)
+    esp_wifi_sta_wpa2_ent_enable();
+#else
+    wifi_station_set_wpa2_enterprise_auth(1);
+#endif
+    esp_wifi_sta_wpa2_ent_set_identity((wifi_cred_t*)login.c_str(), login.length());
+    esp_wifi_sta_wpa2_ent_set_username((wifi_cred_t*)login.c_str(), login.length());
+    esp_wifi_sta_wpa2_ent_set_password((wifi_cred_t*)password.c_str(), password.length());
+}
+
+void ESPReactWifiManagerCore::captiveDns(ESPReactWifiManagerCore& manager, bool apMode)
+{
+#if ESPREACTWIFIMANAGER_LOGGING
+    const Features& features = manager.features;
+#endif
+    DNSServer*& dnsServer = manager.dnsServer;
+    if (!dnsServer && apMode) {
+        dnsServer = new DNSServer();
+        dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
+        if (dnsServer->start(53, F("*"), WiFi.softAPIP())) {
+            WM_PRINTLN(F("Starting DNS server: success"));
+        } else {
+            WM_PRINTLN(F("Starting DNS server: fail"));
+        }
+    } else if (dnsServer && !apMode) {
+        WM_PRINTLN(F("Stopping DNS server"));
+        dnsServer->stop();
+        delete dnsServer;
+        dnsServer = nullptr;
+    }
+}
+
+void ESPReactWifiManagerCore::captiveDnsLoop(ESPReactWifiManagerCore& manager)
+{
+    if (manager.dnsServer) {
+        manager.dnsServer->processNextRequest();
+    }
+}
+
+void ESPReactWifiManagerCore::dedupResults(std::vector<WifiResult>& results)
 {
-    return wifiResults;
+    sort(results.begin(), results.end(), ssidLess);
+    results.erase(unique(results.begin(), results.end(), ssidEqual), results.end());
 }
@@ -1,24 +1,79 @@
 #pragma once
 
 #include <Arduino.h>
+#include <IPAddress.h>
+#include <Ticker.h>
+#include <ESPReactWifiChannels.h>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+namespace fs {
+class FS;
+}
 class AsyncWebServer;
 class AsyncWebServerRequest;
-class ESPReactWifiManager
+class DNSServer;
+
+// 0 removes every log message from the build, set it in build flags of the
+// application, e.g. -DESPREACTWIFIMANAGER_LOGGING=0. Config logging only
+// switches printing of messages compiled in.
+#ifndef ESPREACTWIFIMANAGER_LOGGING
+#define ESPREACTWIFIMANAGER_LOGGING 1
+#endif
+
+// Optional parts of the manager. Disabled ones are not referenced and are
+// dropped by the linker, e.g.
+//   struct SmallConfig : ESPReactWifiManagerConfig {
+//       static constexpr bool enterprise = false;
+//   };
+//   BasicESPReactWifiManager<SmallConfig> wifiManager;
+struct ESPReactWifiManagerConfig {
+    static constexpr bool enterprise = true; // WPA2-Enterprise login
+    static constexpr bool captiveDns = true; // DNS server answering all names in AP mode
+    static constexpr bool scanDedup = true; // one scan result per ssid
+    static constexpr bool logging = ESPREACTWIFIMANAGER_LOGGING; // Serial output
+    static constexpr bool eventNames = true; // ESP32 event names in log, needs logging
+};
+
+class ESPReactWifiManagerCore
 {
 public:
-    ESPReactWifiManager();
 
     struct WifiResult {
         String ssid;
         uint8_t encryptionType;
         int32_t rssi;
-        uint8_t* bssid;
+        uint8_t bssid[6];
         int32_t channel;
         int quality;
         bool isHidden = false;
         bool duplicate = false;
+        uint32_t lastSeen = 0; // millis() of the last scan that found it
+    };
+
+    struct ResultsSnapshot {
+        std::vector<WifiResult> results;
+        uint32_t generation = 0;
+    };
+
+    // Read-only view of scan results, stays valid and unchanged while held
+    class ResultsView {
+    public:
+        explicit ResultsView(std::shared_ptr<const ResultsSnapshot> snapshot)
+            : snapshot(std::move(snapshot)) {}
+
+        std::vector<WifiResult>::const_iterator begin() const { return snapshot->results.begin(); }
+        std::vector<WifiResult>::const_iterator end() const { return snapshot->results.end(); }
+        const WifiResult& operator[](size_t index) const { return snapshot->results[index]; }
+        size_t size() const { return snapshot->results.size(); }
+        bool empty() const { return snapshot->results.empty(); }
+        uint32_t generation() const { return snapshot->generation; }
+
+    private:
+        std::shared_ptr<const ResultsSnapshot> snapshot;
     };
 
     void loop();
@@ -27,10 +82,17 @@ public:
     void setHostname(String hostname);
     void setApOptions(String apName, String apPassword = String());
     void setStaOptions(String ssid, String password = String(), String login = String(), String bssid = String());
+    // zero ip - use DHCP
+    void setStaticIp(IPAddress ip, IPAddress gateway, IPAddress subnet,
+                     IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    // apply last DHCP lease on reconnect to the same network without renewing it,
+    // DHCP again if gateway does not answer or the address is taken
+    void setLeaseReuse(bool enable);
     bool connect();
     bool autoConnect();
     bool startAP();
     void setFallbackToAp(bool enable);
+    void setApChannel(uint8_t channel); // 0 - least congested of 1, 6, 11 from last scan
 
     void setupHandlers(AsyncWebServer *server);
     void onFinished(void (*func)(bool)); // arg bool "is AP mode"
@@ -39,8 +101,247 @@ public:
 
     void finishConnection(bool apMode);
     void scheduleScan(int timeout = 2000);
-    bool scan();
+    bool scan(uint8_t channel = 0); // 0 - all channels, merged into results
     int size();
-    std::vector<WifiResult> results();
+    std::vector<WifiResult> results(); // copy, prefer resultsView()
+    ResultsView resultsView() const;
+    // func(const WifiResult&) for each result, inlined without std::function
+    template<typename Func>
+    void forEachResult(Func&& func) const
+    {
+        for (const WifiResult& result : resultsView()) {
+            func(result);
+        }
+    }
+    size_t resultCount();
+    uint32_t generation(); // changes only when visible results change
+    void setScanMaxAge(uint32_t maxAge); // ms since last seen before removing
+
+    // Where credentials are saved. By default NVS on ESP32 and SPIFFS on ESP8266,
+    // do not serve the root of that file system to clients.
+    void setFileSystem(fs::FS& fileSystem);
+    bool credentialsSaved(); // false if saving on last connect() failed
+    uint32_t credentialWrites(); // flash writes of the credentials file since boot
+    uint32_t gotIpLatency(); // ms from WiFi.begin() to got IP on last connect()
+
+protected:
+    typedef void (*EnterpriseLogin)(const String& login, const String& password);
+    typedef void (*CaptiveDns)(ESPReactWifiManagerCore& manager, bool apMode);
+    typedef void (*CaptiveDnsLoop)(ESPReactWifiManagerCore& manager);
+    typedef void (*DedupResults)(std::vector<WifiResult>& results);
+    typedef const char* (*EventName)(int event);
+
+    // optional parts selected by BasicESPReactWifiManager, null if disabled
+    struct Features {
+        EnterpriseLogin enterpriseLogin;
+        CaptiveDns captiveDns;
+        CaptiveDnsLoop captiveDnsLoop;
+        DedupResults dedupResults;
+        EventName eventName;
+        Print* log;
+    };
+
+    explicit ESPReactWifiManagerCore(const Features& selected);
+    ~ESPReactWifiManagerCore();
+    ESPReactWifiManagerCore(const ESPReactWifiManagerCore&) = delete;
+    ESPReactWifiManagerCore& operator=(const ESPReactWifiManagerCore&) = delete;
+
+    static void enterpriseLogin(const String& login, const String& password);
+    static void captiveDns(ESPReactWifiManagerCore& manager, bool apMode);
+    static void captiveDnsLoop(ESPReactWifiManagerCore& manager);
+    static void dedupResults(std::vector<WifiResult>& results);
+#if defined(ESP32)
+    static const char* eventName(int event);
+#endif
+
+private:
+    // every BSSID seen recently, hidden networks included
+    struct ScanEntry {
+        WifiResult result; // rssi is smoothedRssi rounded to dBm
+        int32_t smoothedRssi; // 1/16 dBm
+    };
+
+    // last address assigned by DHCP, reused on reconnect to the same network
+    struct StoredLease {
+        String ssid;
+        String bssid;
+        uint32_t ip = 0;
+        uint32_t gateway = 0;
+        uint32_t subnet = 0;
+        uint32_t dns1 = 0;
+        uint32_t dns2 = 0;
+    };
+
+    struct StoredCredentials {
+        String ssid;
+        String password;
+        String login;
+        String bssid;
+        StoredLease lease;
+
+        bool operator==(const StoredCredentials& other) const;
+    };
+
+    // Validation of a reused lease. ARP table belongs to the lwIP thread, on
+    // ESP32 it is only touched from callbacks queued with tcpip_callback().
+    struct ArpCheck {
+        uint32_t ip = 0;
+        uint32_t gateway = 0;
+        bool gatewayFound = false;
+        bool addressTaken = false;
+        std::atomic<bool> done;
+    };
 
+    void notFound(AsyncWebServerRequest* request);
+    void setupAP();
+    void checkRetryCount();
+#if defined(ESP32)
+    void onWifiEvent(int event);
+#endif
+    static void reconnect(ESPReactWifiManagerCore* manager);
+
+    void mergeScanResult(const WifiResult& result);
+    void expireScanResults(uint32_t now);
+    void updateResults();
+
+    fs::FS& credentialsFileSystem();
+    bool readCredentialsFile(const char* path, StoredCredentials& credentials);
+    bool parseCredentials(const std::vector<uint8_t>& buffer, const char* source,
+                          StoredCredentials& credentials);
+    bool writeCredentialsFile(const std::vector<uint8_t>& buffer);
+#if defined(ESP32)
+    bool readCredentialsNvs(StoredCredentials& credentials);
+    bool writeCredentialsNvs(const std::vector<uint8_t>& buffer);
+#endif
+    bool loadCredentials();
+    bool saveCredentials(const StoredCredentials& credentials);
+    bool saveCredentials(const String& ssid, const String& password,
+                         const String& login, const String& bssid);
+    void saveLease(const StoredLease& lease);
+
+    bool canReuseLease();
+    void configureIp();
+    void runInTcpip(void (*func)(void*));
+    static void sendArpProbes(void* manager);
+    static void checkArpAnswers(void* manager);
+
+    const Features features;
+
+    bool isConnecting = false;
+    bool fallbackToAp = true;
+
+    String connectSsid;
+    String connectPassword;
+    String connectLogin;
+    String connectBssid;
+
+    String connectApName;
+    String connectApPassword;
+
+    uint32_t shouldScan = 0;
+    uint32_t shouldConnect = 0;
+
+    DNSServer* dnsServer = nullptr;
+    void (*finishedCallback)(bool) = nullptr;
+    void (*notFoundCallback)(AsyncWebServerRequest*) = nullptr;
+    bool (*captiveCallback)(AsyncWebServerRequest*) = nullptr;
+
+    String wifiHostname;
+
+    std::vector<ScanEntry> scanTable;
+    // deduplicated by ssid and sorted by signal, as shown in the portal.
+    // Replaced as a whole on change, readers keep the snapshot they loaded.
+    std::shared_ptr<const ResultsSnapshot> wifiResults;
+    uint32_t scanMaxAge = 5 * 60 * 1000;
+
+    ESPReactWifiChannels channelStats;
+    uint8_t apChannel = 0;
+
+    Ticker wifiReconnectTimer;
+    uint8_t retryCount = 0;
+
+#if defined(ESP8266)
+    std::shared_ptr<void> wifiConnectHandler;
+    std::shared_ptr<void> wifiDisconnectHandler;
+#else
+    size_t wifiEventId = 0;
+#endif
+
+    fs::FS* credentialsFs = nullptr;
+    StoredCredentials storedCredentials;
+    bool storedCredentialsLoaded = false;
+    bool credentialsSaveFailed = false;
+    uint32_t credentialWriteCount = 0;
+
+    IPAddress staticIp;
+    IPAddress staticGateway;
+    IPAddress staticSubnet;
+    IPAddress staticDns1;
+    IPAddress staticDns2;
+    bool leaseReuse = false;
+    bool leaseApplied = false;
+    bool ipConfigured = false;
+
+    uint32_t connectStarted = 0;
+    bool connectPending = false;
+    uint32_t lastGotIpLatency = 0;
+    uint32_t shouldCheckGateway = 0;
+    StoredLease gotLease; // from got IP callback, saved by loop()
+    std::atomic<bool> shouldSaveLease;
+    bool arpCheckPending = false;
+    ArpCheck arpCheck;
+};
+
+// Manager with the optional parts chosen by Config, see ESPReactWifiManagerConfig.
+// Code is shared in ESPReactWifiManagerCore, this only picks the features.
+template<typename Config = ESPReactWifiManagerConfig>
+class BasicESPReactWifiManager : public ESPReactWifiManagerCore
+{
+public:
+    BasicESPReactWifiManager() : ESPReactWifiManagerCore(selectFeatures())
+    {
+        static_assert(!Config::logging || ESPREACTWIFIMANAGER_LOGGING,
+                      "logging is enabled in the config but compiled out by ESPREACTWIFIMANAGER_LOGGING=0");
+    }
+
+private:
+    template<bool enabled>
+    using Enabled = std::integral_constant<bool, enabled>;
+
+    static Features selectFeatures()
+    {
+        Features selected;
+        selected.enterpriseLogin = enterprise(Enabled<Config::enterprise>());
+        selected.captiveDns = dns(Enabled<Config::captiveDns>());
+        selected.captiveDnsLoop = dnsLoop(Enabled<Config::captiveDns>());
+        selected.dedupResults = dedup(Enabled<Config::scanDedup>());
+        selected.eventName = eventNames(Enabled<Config::logging && Config::eventNames>());
+        selected.log = Config::logging ? &Serial : nullptr;
+        return selected;
+    }
+
+    // only the overload called is instantiated, disabled parts are never referenced
+    static EnterpriseLogin enterprise(std::true_type) { return &ESPReactWifiManagerCore::enterpriseLogin; }
+    static EnterpriseLogin enterprise(std::false_type) { return nullptr; }
+    static CaptiveDns dns(std::true_type) { return &ESPReactWifiManagerCore::captiveDns; }
+    static CaptiveDns dns(std::false_type) { return nullptr; }
+    static CaptiveDnsLoop dnsLoop(std::true_type) { return &ESPReactWifiManagerCore::captiveDnsLoop; }
+    static CaptiveDnsLoop dnsLoop(std::false_type) { return nullptr; }
+    static DedupResults dedup(std::true_type) { return &ESPReactWifiManagerCore::dedupResults; }
+    static DedupResults dedup(std::false_type) { return nullptr; }
+    static EventName eventNames(std::true_type)
+    {
+#if defined(ESP32)
+        return &ESPReactWifiManagerCore::eventName;
+#else
+        return nullptr; // ESP8266 events are separate callbacks
+#endif
+    }
+    static EventName eventNames(std::false_type) { return nullptr; }
+};
+
+// Manager with every feature. A class, not a typedef, so applications can
+// keep forward declaring it.
+class ESPReactWifiManager : public BasicESPReactWifiManager<>
+{
 };
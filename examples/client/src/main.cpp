@@ -1,11 +1,30 @@
 #include <Arduino.h>
 #include <ESPReactWifiManager.h>
 #include <ESPAsyncWebServer.h>
+#if defined(ESP8266)
+#include <FS.h>
+#else
+#include <SPIFFS.h>
+#endif
 
 namespace {
 
+#if defined(MINIMAL_WIFI_MANAGER)
+// smallest build, see env:esp8266_minimal
+struct WifiManagerConfig : ESPReactWifiManagerConfig {
+    static constexpr bool enterprise = false;
+    static constexpr bool captiveDns = false;
+    static constexpr bool scanDedup = false;
+    static constexpr bool logging = false;
+    static constexpr bool eventNames = false;
+};
+typedef BasicESPReactWifiManager<WifiManagerConfig> WifiManager;
+#else
+typedef ESPReactWifiManager WifiManager;
+#endif
+
 AsyncWebServer *server = nullptr;
-ESPReactWifiManager *wifiManager = nullptr;
+WifiManager *wifiManager = nullptr;
 
 } // namespace
 
@@ -26,24 +45,27 @@ void setup()
     WiFi.setSleepMode(WIFI_NONE_SLEEP);
 #endif
 
+    // only the web directory is served, the root of SPIFFS holds
+    // the saved Wi-Fi credentials on ESP8266
     server = new AsyncWebServer(80);
-    server->serveStatic(PSTR("/static/js/"), SPIFFS, PSTR("/"))
+    server->serveStatic(PSTR("/static/js/"), SPIFFS, PSTR("/www/"))
         .setCacheControl(PSTR("max-age=86400"));
-    server->serveStatic(PSTR("/static/css/"), SPIFFS, PSTR("/"))
+    server->serveStatic(PSTR("/static/css/"), SPIFFS, PSTR("/www/"))
         .setCacheControl(PSTR("max-age=86400"));
-    server->serveStatic(PSTR("/"), SPIFFS, PSTR("/"))
+    server->serveStatic(PSTR("/"), SPIFFS, PSTR("/www/"))
         .setCacheControl(PSTR("max-age=86400"))
         .setDefaultFile(PSTR("wifi.html"));
 
-    wifiManager = new ESPReactWifiManager();
+    wifiManager = new WifiManager();
     wifiManager->onFinished([](bool isAPMode) {
         server->begin();
     });
     wifiManager->onNotFound([](AsyncWebServerRequest* request) {
-        request->send(SPIFFS, F("wifi.html"));
+        request->send(SPIFFS, F("/www/wifi.html"));
     });
     wifiManager->setupHandlers(server);
-    wifiManager->autoConnect(F("REACT"));
+    wifiManager->setApOptions(F("REACT"));
+    wifiManager->autoConnect();
 }
 
 void loop()
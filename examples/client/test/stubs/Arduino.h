@@ -0,0 +1,135 @@
+#pragma once
+
+// Minimal host stand-in for the Arduino core, enough to build the library
+// in native tests. State is defined once per test in FakePlatform.h.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t uint8;
+typedef uint32_t uint32;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+#define PSTR(string_literal) (string_literal)
+#define PROGMEM
+#define strlen_P strlen
+
+class String
+{
+public:
+    String() {}
+    String(const char* value) : data(value ? value : "") {}
+    String(const __FlashStringHelper* value) : data(reinterpret_cast<const char*>(value)) {}
+    String(const std::string& value) : data(value) {}
+    explicit String(int value) : data(std::to_string(value)) {}
+    explicit String(unsigned int value) : data(std::to_string(value)) {}
+    explicit String(long value) : data(std::to_string(value)) {}
+    explicit String(unsigned long value) : data(std::to_string(value)) {}
+
+    const char* c_str() const { return data.c_str(); }
+    unsigned int length() const { return data.size(); }
+    bool isEmpty() const { return data.empty(); }
+    void reserve(unsigned int size) { data.reserve(size); }
+
+    bool startsWith(const String& prefix) const
+    {
+        return data.compare(0, prefix.data.size(), prefix.data) == 0;
+    }
+    bool endsWith(const String& suffix) const
+    {
+        return data.size() >= suffix.data.size()
+                && data.compare(data.size() - suffix.data.size(), suffix.data.size(), suffix.data) == 0;
+    }
+    bool equalsIgnoreCase(const String& other) const
+    {
+        return data.size() == other.data.size()
+                && strncasecmp(data.c_str(), other.data.c_str(), data.size()) == 0;
+    }
+    int indexOf(const String& value, unsigned int from = 0) const
+    {
+        size_t position = data.find(value.data, from);
+        return position == std::string::npos ? -1 : int(position);
+    }
+    String substring(unsigned int from) const
+    {
+        return from < data.size() ? String(data.substr(from)) : String();
+    }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from < data.size() && from < to ? String(data.substr(from, to - from)) : String();
+    }
+
+    String& operator+=(const String& other) { data += other.data; return *this; }
+    String& operator+=(const char* other) { data += other; return *this; }
+    String& operator+=(char other) { data += other; return *this; }
+    String& operator+=(const __FlashStringHelper* other) { return *this += reinterpret_cast<const char*>(other); }
+
+    bool operator==(const String& other) const { return data == other.data; }
+    bool operator!=(const String& other) const { return data != other.data; }
+    bool operator<(const String& other) const { return data < other.data; }
+    char operator[](unsigned int index) const { return data[index]; }
+
+private:
+    std::string data;
+};
+
+inline String operator+(String left, const String& right)
+{
+    left += right;
+    return left;
+}
+
+class Print
+{
+public:
+    template<typename T> size_t print(const T&) { return 0; }
+    template<typename T> size_t print(const T&, int) { return 0; }
+    size_t println() { return 0; }
+    template<typename T> size_t println(const T&) { return 0; }
+    template<typename T> size_t println(const T&, int) { return 0; }
+    size_t printf(const char*, ...) { return 0; }
+    size_t printf_P(const char*, ...) { return 0; }
+    void flush() {}
+};
+
+class IPAddress
+{
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint32_t value) : address(value) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | (uint32_t(d) << 24)) {}
+
+    operator uint32_t() const { return address; }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+    bool operator!=(const IPAddress& other) const { return address != other.address; }
+    uint8_t operator[](int index) const { return (address >> (8 * index)) & 0xff; }
+
+    String toString() const
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u",
+                 (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buffer);
+    }
+
+private:
+    uint32_t address;
+};
+
+class EspClass
+{
+public:
+    void restart() { ++restarts; }
+    uint32_t restarts = 0;
+};
+
+extern Print Serial;
+extern EspClass ESP;
+
+uint32_t millis();
+void delay(uint32_t ms);
@@ -0,0 +1,102 @@
+#pragma once
+
+// The part of ArduinoJson 6 used by the library: flat objects of strings
+// and integers, serialized the same way.
+
+#include <Arduino.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#define JSON_OBJECT_SIZE(NUMBER_OF_ELEMENTS) ((NUMBER_OF_ELEMENTS) * 16)
+
+class JsonVariant
+{
+public:
+    explicit JsonVariant(std::string* json) : json(json) {}
+
+    JsonVariant& operator=(const String& value)
+    {
+        *json = "\"";
+        for (const char* c = value.c_str(); *c; ++c) {
+            if (*c == '"' || *c == '\\') {
+                *json += '\\';
+                *json += *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                *json += escaped;
+            } else {
+                *json += *c;
+            }
+        }
+        *json += '"';
+        return *this;
+    }
+    JsonVariant& operator=(const char* value) { return *this = String(value); }
+    JsonVariant& operator=(int value)
+    {
+        *json = std::to_string(value);
+        return *this;
+    }
+
+private:
+    std::string* json;
+};
+
+class JsonObject
+{
+public:
+    explicit JsonObject(std::vector<std::pair<std::string, std::string>>* members) : members(members) {}
+
+    JsonVariant operator[](const __FlashStringHelper* key)
+    {
+        members->push_back(std::make_pair(std::string(reinterpret_cast<const char*>(key)), std::string()));
+        return JsonVariant(&members->back().second);
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>>* members;
+};
+
+class DynamicJsonDocument
+{
+public:
+    explicit DynamicJsonDocument(size_t capacity) { members.reserve(capacity / JSON_OBJECT_SIZE(1)); }
+
+    template<typename T> T to()
+    {
+        members.clear();
+        return T(&members);
+    }
+
+    std::string json() const
+    {
+        std::string result = "{";
+        for (size_t i = 0; i < members.size(); i++) {
+            result += (i > 0 ? ",\"" : "\"") + members[i].first + "\":" + members[i].second;
+        }
+        return result + "}";
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> members;
+};
+
+inline size_t measureJson(const DynamicJsonDocument& doc)
+{
+    return doc.json().size();
+}
+
+// writes at most size - 1 characters and a null terminator
+inline size_t serializeJson(const DynamicJsonDocument& doc, char* buffer, size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    std::string json = doc.json();
+    size_t length = std::min(json.size(), size - 1);
+    memcpy(buffer, json.data(), length);
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum class DNSReplyCode { NoError = 0 };
+
+class DNSServer
+{
+public:
+    void processNextRequest() {}
+    void setErrorReplyCode(DNSReplyCode) {}
+    bool start(uint16_t, const String&, const IPAddress&) { return true; }
+    void stop() {}
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum { ENC_TYPE_WEP = 5, ENC_TYPE_TKIP = 2, ENC_TYPE_CCMP = 4, ENC_TYPE_NONE = 7 };
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+struct WiFiEventStationModeGotIP {};
+struct WiFiEventStationModeDisconnected {};
+struct WiFiEventHandlerOpaque {};
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+struct FakeNetwork {
+    String ssid;
+    uint8_t encryptionType;
+    int32_t rssi;
+    uint8_t bssid[6];
+    int32_t channel;
+    bool isHidden;
+};
+
+// Scriptable WiFi: tests fill networks and addresses, read back calls
+class FakeWiFi
+{
+public:
+    void persistent(bool enable) { persistentEnabled = enable; }
+    wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool mode(WiFiMode_t value) { currentMode = value; return true; }
+    WiFiMode_t getMode() { return currentMode; }
+
+    bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+    bool softAP(const char*, const char* = nullptr, int channel = 1, int = 0, int = 4)
+    {
+        apChannel = channel;
+        return true;
+    }
+    bool softAPdisconnect(bool) { return true; }
+    uint8_t softAPgetStationNum() { return apStations; }
+    IPAddress softAPIP() { return apIP; }
+
+    bool hostname(const char*) { return true; }
+    int begin(const char* ssid, const char* passphrase = nullptr, int32_t = 0,
+              const uint8_t* = nullptr, bool = true)
+    {
+        ++beginCount;
+        beginSsid = ssid;
+        beginPassphrase = passphrase ? passphrase : "";
+        return WL_DISCONNECTED;
+    }
+    bool config(IPAddress ip, IPAddress gateway, IPAddress subnet,
+                IPAddress = IPAddress(), IPAddress = IPAddress())
+    {
+        configIP = ip;
+        configGateway = gateway;
+        configSubnet = subnet;
+        return true;
+    }
+    bool disconnect(bool = false) { connected = false; return true; }
+
+    IPAddress localIP() { return stationIP; }
+    IPAddress subnetMask() { return stationSubnet; }
+    IPAddress gatewayIP() { return stationGateway; }
+    IPAddress dnsIP(uint8_t = 0) { return stationGateway; }
+    String SSID() { return beginSsid; }
+    String BSSIDstr() { return String("00:11:22:33:44:55"); }
+
+    int8_t scanNetworks(bool = false, bool showHidden = false, uint8_t channel = 0, uint8_t* = nullptr)
+    {
+        scanned.clear();
+        for (const FakeNetwork& network : networks) {
+            if ((showHidden || !network.isHidden) && (channel == 0 || network.channel == channel)) {
+                scanned.push_back(network);
+            }
+        }
+        ++scanCount;
+        return scanned.size();
+    }
+    void scanDelete() { scanned.clear(); }
+    bool getNetworkInfo(uint8_t index, String& ssid, uint8_t& encryptionType, int32_t& rssi,
+                        uint8_t*& bssid, int32_t& channel, bool& isHidden)
+    {
+        if (index >= scanned.size()) {
+            return false;
+        }
+        FakeNetwork& network = scanned[index];
+        ssid = network.isHidden ? String() : network.ssid;
+        encryptionType = network.encryptionType;
+        rssi = network.rssi;
+        bssid = network.bssid;
+        channel = network.channel;
+        isHidden = network.isHidden;
+        return true;
+    }
+    void printDiag(Print&) {}
+
+    WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)> handler)
+    {
+        gotIpHandler = handler;
+        return std::make_shared<WiFiEventHandlerOpaque>();
+    }
+    WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> handler)
+    {
+        disconnectedHandler = handler;
+        return std::make_shared<WiFiEventHandlerOpaque>();
+    }
+
+    std::vector<FakeNetwork> networks;
+    std::vector<FakeNetwork> scanned;
+    WiFiMode_t currentMode = WIFI_OFF;
+    bool persistentEnabled = true;
+    bool connected = false;
+    int apChannel = 0;
+    uint8_t apStations = 0;
+    IPAddress apIP = IPAddress(8, 8, 8, 8);
+    IPAddress stationIP;
+    IPAddress stationSubnet;
+    IPAddress stationGateway;
+    IPAddress configIP;
+    IPAddress configGateway;
+    IPAddress configSubnet;
+    String beginSsid;
+    String beginPassphrase;
+    uint32_t beginCount = 0;
+    uint32_t scanCount = 0;
+    std::function<void(const WiFiEventStationModeGotIP&)> gotIpHandler;
+    std::function<void(const WiFiEventStationModeDisconnected&)> disconnectedHandler;
+};
+
+extern FakeWiFi WiFi;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+class AsyncClient
+{
+public:
+    explicit AsyncClient(IPAddress local) : local(local) {}
+    IPAddress localIP() const { return local; }
+
+private:
+    IPAddress local;
+};
+
+// Keeps what a handler answered, chunked bodies are pulled with nextChunk()
+class AsyncWebServerResponse
+{
+public:
+    AsyncWebServerResponse(int code, const String& contentType, const String& content)
+        : code(code), contentType(contentType), content(content) {}
+    AsyncWebServerResponse(const String& contentType, AwsResponseFiller filler)
+        : code(200), contentType(contentType), filler(filler) {}
+
+    bool chunked() const { return static_cast<bool>(filler); }
+    bool finished() const { return !filler || done; }
+
+    // like the server, index is the count of bytes already sent
+    size_t nextChunk(uint8_t* buffer, size_t maxLen)
+    {
+        size_t length = filler(buffer, maxLen, sent);
+        if (length == RESPONSE_TRY_AGAIN) {
+            return 0;
+        }
+        if (length == 0) {
+            done = true;
+        }
+        if (keepContent) {
+            content += String(std::string(reinterpret_cast<const char*>(buffer), length));
+        }
+        sent += length;
+        return length;
+    }
+
+    int code;
+    String contentType;
+    String content;
+    String location;
+    bool keepContent = true; // collect chunks into content
+
+private:
+    AwsResponseFiller filler;
+    size_t sent = 0;
+    bool done = false;
+};
+
+class AsyncWebServerRequest
+{
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String& url, IPAddress localIP)
+        : requestMethod(method), requestUrl(url), requestClient(localIP) {}
+
+    void addArg(const String& name, const String& value) { arguments.push_back(std::make_pair(name, value)); }
+
+    WebRequestMethodComposite method() const { return requestMethod; }
+    const String& url() const { return requestUrl; }
+    AsyncClient* client() { return &requestClient; }
+    size_t args() const { return arguments.size(); }
+    const String& argName(size_t index) const { return arguments[index].first; }
+    const String& arg(size_t index) const { return arguments[index].second; }
+
+    void send(int code, const String& contentType = String(), const String& content = String())
+    {
+        send(new AsyncWebServerResponse(code, contentType, content));
+    }
+    void send(AsyncWebServerResponse* response) { answer.reset(response); }
+    void redirect(const String& url)
+    {
+        send(302);
+        answer->location = url;
+    }
+    AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller callback)
+    {
+        return new AsyncWebServerResponse(contentType, callback);
+    }
+
+    AsyncWebServerResponse* response() const { return answer.get(); }
+
+private:
+    WebRequestMethodComposite requestMethod;
+    String requestUrl;
+    AsyncClient requestClient;
+    std::vector<std::pair<String, String>> arguments;
+    std::unique_ptr<AsyncWebServerResponse> answer;
+};
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+
+class AsyncWebServer
+{
+public:
+    explicit AsyncWebServer(uint16_t) {}
+
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+    {
+        handlers[uri] = std::make_pair(method, onRequest);
+    }
+    void onNotFound(ArRequestHandlerFunction fn) { notFound = fn; }
+
+    // dispatch by exact path as the server does for the handlers above
+    void handle(AsyncWebServerRequest* request)
+    {
+        auto handler = handlers.find(request->url().c_str());
+        if (handler != handlers.end() && (handler->second.first & request->method())) {
+            handler->second.second(request);
+        } else if (notFound) {
+            notFound(request);
+        } else {
+            request->send(404);
+        }
+    }
+
+private:
+    std::map<std::string, std::pair<WebRequestMethodComposite, ArRequestHandlerFunction>> handlers;
+    ArRequestHandlerFunction notFound;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace fs {
+
+// In-memory file system, files are written on close()
+class File
+{
+public:
+    File() {}
+    File(std::map<std::string, std::vector<uint8_t>>* files, const std::string& path, bool write)
+        : files(files), path(path), writing(write)
+    {
+        if (!write) {
+            contents = (*files)[path];
+        }
+    }
+
+    explicit operator bool() const { return files != nullptr; }
+    size_t size() { return contents.size(); }
+    size_t read(uint8_t* buffer, size_t length)
+    {
+        length = std::min(length, contents.size() - position);
+        memcpy(buffer, contents.data() + position, length);
+        position += length;
+        return length;
+    }
+    size_t write(const uint8_t* buffer, size_t length)
+    {
+        contents.insert(contents.end(), buffer, buffer + length);
+        return length;
+    }
+    void close()
+    {
+        if (files && writing) {
+            (*files)[path] = contents;
+        }
+        files = nullptr;
+    }
+
+private:
+    std::map<std::string, std::vector<uint8_t>>* files = nullptr;
+    std::string path;
+    std::vector<uint8_t> contents;
+    size_t position = 0;
+    bool writing = false;
+};
+
+class FS
+{
+public:
+    File open(const char* path, const char* mode)
+    {
+        bool write = mode[0] == 'w';
+        if (!mounted || (!write && !exists(path))) {
+            return File();
+        }
+        return File(&files, path, write);
+    }
+    bool exists(const char* path) { return mounted && files.count(path) > 0; }
+    bool remove(const char* path) { return mounted && files.erase(path) > 0; }
+    bool rename(const char* from, const char* to)
+    {
+        if (!exists(from) || exists(to)) {
+            return false;
+        }
+        files[to] = files[from];
+        files.erase(from);
+        return true;
+    }
+
+    std::map<std::string, std::vector<uint8_t>> files;
+    bool mounted = true; // false - every operation fails, as before begin()
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+extern fs::FS SPIFFS;
@@ -0,0 +1,30 @@
+#pragma once
+
+// State of the host stand-ins, include from exactly one file of a test.
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <FS.h>
+#include <lwip/etharp.h>
+
+Print Serial;
+EspClass ESP;
+FakeWiFi WiFi;
+fs::FS SPIFFS;
+struct netif* netif_list = nullptr;
+std::vector<uint32_t> fakeArpRequests;
+std::vector<uint32_t> fakeArpTable;
+
+// millis() only moves when the code under test calls delay() or a test
+// advances it, so the library timing is deterministic
+uint32_t fakeMillis = 0;
+
+uint32_t millis()
+{
+    return fakeMillis;
+}
+
+void delay(uint32_t ms)
+{
+    fakeMillis += ms;
+}
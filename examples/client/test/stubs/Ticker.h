@@ -0,0 +1,10 @@
+#pragma once
+
+// Timers never fire on host, tests call the manager directly
+class Ticker
+{
+public:
+    void once(float, void (*)()) {}
+    template<typename TArg> void once(float, void (*)(TArg), TArg) {}
+    void detach() {}
+};
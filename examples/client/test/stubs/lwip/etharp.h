@@ -0,0 +1,26 @@
+#pragma once
+
+#include <lwip/netif.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <vector>
+
+struct eth_addr {
+    uint8_t addr[6];
+};
+
+// addresses asked for and addresses that answer, defined in FakePlatform.h
+extern std::vector<uint32_t> fakeArpRequests;
+extern std::vector<uint32_t> fakeArpTable;
+
+inline int etharp_request(struct netif*, const ip4_addr_t* address)
+{
+    fakeArpRequests.push_back(address->addr);
+    return 0;
+}
+
+inline ssize_t etharp_find_addr(struct netif*, const ip4_addr_t* address, struct eth_addr**, const ip4_addr_t**)
+{
+    std::vector<uint32_t>::iterator entry = std::find(fakeArpTable.begin(), fakeArpTable.end(), address->addr);
+    return entry == fakeArpTable.end() ? -1 : entry - fakeArpTable.begin();
+}
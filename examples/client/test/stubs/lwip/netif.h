@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+#define ip4_addr_get_u32(address) ((address)->addr)
+#define ip4_addr_set_u32(address, value) ((address)->addr = (value))
+
+struct netif {
+    struct netif* next;
+    ip4_addr_t ip_addr;
+};
+
+#define netif_ip4_addr(interface) (&(interface)->ip_addr)
+
+// empty unless a test adds the station interface, defined in FakePlatform.h
+extern struct netif* netif_list;
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// included inside extern "C" by the library
+typedef uint8_t uint8;
+typedef uint32_t uint32;
+
+struct station_config {
+    uint8 ssid[32];
+    uint8 password[64];
+};
+
+inline bool wifi_station_get_config_default(struct station_config* config)
+{
+    memset(config, 0, sizeof(*config));
+    return true;
+}
+
+inline bool wifi_station_disconnect()
+{
+    return true;
+}
+
+#define ETS_UART_INTR_DISABLE()
+#define ETS_UART_INTR_ENABLE()
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <user_interface.h>
+
+inline int wifi_station_set_wpa2_enterprise_auth(int) { return 0; }
+inline int wifi_station_set_enterprise_identity(uint8*, int) { return 0; }
+inline int wifi_station_set_enterprise_username(uint8*, int) { return 0; }
+inline int wifi_station_set_enterprise_password(uint8*, int) { return 0; }
@@ -0,0 +1,144 @@
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+namespace {
+
+struct ScanEntry {
+    int32_t channel;
+    int32_t rssi;
+};
+
+uint8_t chooseChannel(const ScanEntry* entries, size_t count)
+{
+    ESPReactWifiChannels channels;
+    for (size_t i = 0; i < count; i++) {
+        channels.add(entries[i].channel, entries[i].rssi);
+    }
+    return channels.leastCongested();
+}
+
+void addNetwork(uint8_t id, int32_t channel, int32_t rssi)
+{
+    FakeNetwork network = { String("Neighbour"), ENC_TYPE_CCMP, rssi, { 0x02, 0, 0, 0, 0, id }, channel, false };
+    WiFi.networks.push_back(network);
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 1000;
+    SPIFFS = fs::FS();
+    WiFi = FakeWiFi();
+}
+
+void tearDown()
+{
+}
+
+void test_no_scan_data_uses_default_channel()
+{
+    ESPReactWifiChannels channels;
+    TEST_ASSERT_FALSE(channels.valid());
+    TEST_ASSERT_EQUAL_UINT8(ESPReactWifiChannels::defaultChannel, channels.leastCongested());
+}
+
+void test_picks_free_channel()
+{
+    const ScanEntry entries[] = {
+        { 1, -40 }, { 1, -60 }, { 6, -55 }, { 6, -70 }, { 7, -65 },
+    };
+    TEST_ASSERT_EQUAL_UINT8(11, chooseChannel(entries, 5));
+}
+
+void test_strong_ap_outweighs_weak_ones()
+{
+    const ScanEntry entries[] = {
+        { 1, -40 },
+        { 6, -92 }, { 6, -94 }, { 6, -95 },
+        { 11, -45 },
+    };
+    TEST_ASSERT_EQUAL_UINT8(6, chooseChannel(entries, 5));
+}
+
+void test_overlapping_channels_count()
+{
+    // nothing on 1, 6 or 11 itself, but 2 and 3 overlap 1 and 10 overlaps 11
+    const ScanEntry entries[] = {
+        { 2, -50 }, { 3, -60 }, { 10, -50 },
+    };
+    TEST_ASSERT_EQUAL_UINT8(6, chooseChannel(entries, 3));
+}
+
+void test_equal_load_prefers_fewer_aps()
+{
+    // two APs of quality 20 vs one of quality 50, both load 60
+    const ScanEntry entries[] = {
+        { 1, -90 }, { 1, -90 },
+        { 6, -75 },
+        { 11, -75 }, { 11, -90 },
+    };
+    TEST_ASSERT_EQUAL_UINT8(6, chooseChannel(entries, 5));
+}
+
+void test_ignores_invalid_channels()
+{
+    ESPReactWifiChannels channels;
+    channels.add(0, -40);
+    channels.add(36, -40);
+    TEST_ASSERT_FALSE(channels.valid());
+
+    channels.add(13, -40);
+    TEST_ASSERT_TRUE(channels.valid());
+    TEST_ASSERT_EQUAL_UINT8(1, channels.apCount(13));
+    TEST_ASSERT_EQUAL_UINT32(110, channels.occupancy(13));
+    TEST_ASSERT_EQUAL_UINT8(1, channels.leastCongested());
+}
+
+void test_signal_quality()
+{
+    TEST_ASSERT_EQUAL_INT(0, ESPReactWifiChannels::signalQuality(-100));
+    TEST_ASSERT_EQUAL_INT(0, ESPReactWifiChannels::signalQuality(-120));
+    TEST_ASSERT_EQUAL_INT(50, ESPReactWifiChannels::signalQuality(-75));
+    TEST_ASSERT_EQUAL_INT(100, ESPReactWifiChannels::signalQuality(-50));
+    TEST_ASSERT_EQUAL_INT(100, ESPReactWifiChannels::signalQuality(-20));
+}
+
+void test_auto_connect_scans_before_first_ap()
+{
+    addNetwork(1, 1, -40);
+    addNetwork(2, 1, -45);
+    ESPReactWifiManager manager;
+    manager.setApOptions("Setup");
+    TEST_ASSERT_TRUE(manager.autoConnect());
+    TEST_ASSERT_EQUAL(1, WiFi.scanCount);
+    TEST_ASSERT_EQUAL(WIFI_AP, WiFi.getMode());
+    TEST_ASSERT_EQUAL(6, WiFi.apChannel);
+}
+
+void test_fixed_ap_channel_skips_scan()
+{
+    addNetwork(1, 11, -40);
+    ESPReactWifiManager manager;
+    manager.setApOptions("Setup");
+    manager.setApChannel(11);
+    TEST_ASSERT_TRUE(manager.autoConnect());
+    TEST_ASSERT_EQUAL(0, WiFi.scanCount);
+    TEST_ASSERT_EQUAL(11, WiFi.apChannel);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_scan_data_uses_default_channel);
+    RUN_TEST(test_picks_free_channel);
+    RUN_TEST(test_strong_ap_outweighs_weak_ones);
+    RUN_TEST(test_overlapping_channels_count);
+    RUN_TEST(test_equal_load_prefers_fewer_aps);
+    RUN_TEST(test_ignores_invalid_channels);
+    RUN_TEST(test_signal_quality);
+    RUN_TEST(test_auto_connect_scans_before_first_ap);
+    RUN_TEST(test_fixed_ap_channel_skips_scan);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+// applications forward declare the manager in their headers
+class ESPReactWifiManager;
+
+namespace {
+
+struct MinimalConfig : ESPReactWifiManagerConfig {
+    static constexpr bool enterprise = false;
+    static constexpr bool captiveDns = false;
+    static constexpr bool scanDedup = false;
+    static constexpr bool logging = false;
+    static constexpr bool eventNames = false;
+};
+
+typedef BasicESPReactWifiManager<MinimalConfig> MinimalWifiManager;
+
+void addNetwork(const char* ssid, uint8_t id, int32_t rssi)
+{
+    FakeNetwork network = { String(ssid), ENC_TYPE_CCMP, rssi, { 0x02, 0, 0, 0, 0, id }, 1, false };
+    WiFi.networks.push_back(network);
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 1000;
+    SPIFFS.files.clear();
+    WiFi = FakeWiFi();
+}
+
+void tearDown()
+{
+}
+
+void test_default_config_merges_same_ssid()
+{
+    addNetwork("Home", 1, -60);
+    addNetwork("Home", 2, -50);
+    addNetwork("Office", 3, -70);
+    ESPReactWifiManager manager;
+    manager.scan();
+    TEST_ASSERT_EQUAL(2, manager.resultCount());
+    TEST_ASSERT_EQUAL(-50, manager.resultsView()[0].rssi);
+}
+
+void test_without_dedup_lists_every_bssid()
+{
+    addNetwork("Home", 1, -60);
+    addNetwork("Home", 2, -50);
+    addNetwork("Office", 3, -70);
+    MinimalWifiManager manager;
+    manager.scan();
+    TEST_ASSERT_EQUAL(3, manager.resultCount());
+}
+
+void test_enterprise_login_goes_to_supplicant()
+{
+    ESPReactWifiManager manager;
+    manager.setStaOptions("Corporate", "secret", "user");
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL(1, WiFi.beginCount);
+    TEST_ASSERT_EQUAL_STRING("", WiFi.beginPassphrase.c_str());
+}
+
+void test_without_enterprise_login_is_refused()
+{
+    MinimalWifiManager manager;
+    manager.setStaOptions("Corporate", "secret", "user");
+    TEST_ASSERT_FALSE(manager.connect());
+    TEST_ASSERT_EQUAL(0, WiFi.beginCount);
+
+    manager.setStaOptions("Home", "secret");
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_STRING("secret", WiFi.beginPassphrase.c_str());
+}
+
+void test_start_ap_without_captive_dns()
+{
+    MinimalWifiManager manager;
+    manager.setApOptions("Setup");
+    TEST_ASSERT_TRUE(manager.startAP());
+    manager.loop();
+    TEST_ASSERT_EQUAL(WIFI_AP, WiFi.getMode());
+}
+
+void test_instances_keep_own_results()
+{
+    addNetwork("Home", 1, -60);
+    ESPReactWifiManager first;
+    MinimalWifiManager second;
+    first.scan();
+    TEST_ASSERT_EQUAL(1, first.resultCount());
+    TEST_ASSERT_EQUAL(0, second.resultCount());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_config_merges_same_ssid);
+    RUN_TEST(test_without_dedup_lists_every_bssid);
+    RUN_TEST(test_enterprise_login_goes_to_supplicant);
+    RUN_TEST(test_without_enterprise_login_is_refused);
+    RUN_TEST(test_start_ap_without_captive_dns);
+    RUN_TEST(test_instances_keep_own_results);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+namespace {
+
+const char savedFile[] = "/wifi.cred";
+const char tempFile[] = "/wifi.cred.tmp";
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 1000;
+    SPIFFS = fs::FS();
+    WiFi = FakeWiFi();
+}
+
+void tearDown()
+{
+}
+
+void test_reconnects_do_not_rewrite_credentials()
+{
+    ESPReactWifiManager manager;
+    manager.setStaOptions("Home", "secret");
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_TRUE(manager.credentialsSaved());
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+    TEST_ASSERT_FALSE(WiFi.persistentEnabled);
+
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(manager.connect());
+    }
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+    TEST_ASSERT_EQUAL(21, WiFi.beginCount);
+}
+
+void test_saved_network_is_used_after_reboot()
+{
+    {
+        ESPReactWifiManager manager;
+        manager.setStaOptions("Home", "secret", "", "00:11:22:33:44:55");
+        TEST_ASSERT_TRUE(manager.connect());
+    }
+    ESPReactWifiManager manager;
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_STRING("Home", WiFi.beginSsid.c_str());
+    TEST_ASSERT_EQUAL_STRING("secret", WiFi.beginPassphrase.c_str());
+    TEST_ASSERT_EQUAL(0, manager.credentialWrites());
+}
+
+void test_changed_password_is_written_once()
+{
+    ESPReactWifiManager manager;
+    manager.setStaOptions("Home", "secret");
+    manager.connect();
+    manager.setStaOptions("Home", "changed");
+    manager.connect();
+    manager.connect();
+    TEST_ASSERT_EQUAL(2, manager.credentialWrites());
+
+    ESPReactWifiManager rebooted;
+    rebooted.connect();
+    TEST_ASSERT_EQUAL_STRING("changed", WiFi.beginPassphrase.c_str());
+}
+
+void test_checksum_mismatch_is_rejected()
+{
+    {
+        ESPReactWifiManager manager;
+        manager.setStaOptions("Home", "secret");
+        manager.connect();
+    }
+    std::vector<uint8_t>& contents = SPIFFS.files[savedFile];
+    contents[8] ^= 0x01;
+
+    ESPReactWifiManager manager;
+    TEST_ASSERT_FALSE(manager.connect());
+    TEST_ASSERT_EQUAL(1, WiFi.beginCount);
+}
+
+void test_unfinished_save_is_recovered()
+{
+    {
+        ESPReactWifiManager manager;
+        manager.setStaOptions("Home", "secret");
+        manager.connect();
+    }
+    // power lost between writing the new file and renaming it
+    SPIFFS.files[tempFile] = SPIFFS.files[savedFile];
+    SPIFFS.files.erase(savedFile);
+
+    ESPReactWifiManager manager;
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_STRING("Home", WiFi.beginSsid.c_str());
+    TEST_ASSERT_EQUAL(0, manager.credentialWrites());
+}
+
+void test_corrupted_file_falls_back_to_unfinished_save()
+{
+    {
+        ESPReactWifiManager manager;
+        manager.setStaOptions("Home", "secret");
+        manager.connect();
+    }
+    SPIFFS.files[tempFile] = SPIFFS.files[savedFile];
+    SPIFFS.files[savedFile].resize(6);
+
+    ESPReactWifiManager manager;
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_STRING("secret", WiFi.beginPassphrase.c_str());
+}
+
+void test_unmounted_file_system_keeps_sdk_persistence()
+{
+    SPIFFS.mounted = false;
+    ESPReactWifiManager manager;
+    manager.setStaOptions("Home", "secret");
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_FALSE(manager.credentialsSaved());
+    TEST_ASSERT_TRUE(WiFi.persistentEnabled);
+    TEST_ASSERT_EQUAL(1, WiFi.beginCount);
+
+    SPIFFS.mounted = true;
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_TRUE(manager.credentialsSaved());
+    TEST_ASSERT_FALSE(WiFi.persistentEnabled);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reconnects_do_not_rewrite_credentials);
+    RUN_TEST(test_saved_network_is_used_after_reboot);
+    RUN_TEST(test_changed_password_is_written_once);
+    RUN_TEST(test_checksum_mismatch_is_rejected);
+    RUN_TEST(test_unfinished_save_is_recovered);
+    RUN_TEST(test_corrupted_file_falls_back_to_unfinished_save);
+    RUN_TEST(test_unmounted_file_system_keeps_sdk_persistence);
+    return UNITY_END();
+}
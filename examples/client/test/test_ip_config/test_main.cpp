@@ -0,0 +1,172 @@
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+namespace {
+
+const IPAddress leaseIp(192, 168, 1, 50);
+const IPAddress leaseGateway(192, 168, 1, 1);
+const IPAddress leaseSubnet(255, 255, 255, 0);
+
+netif station;
+
+// DHCP assigned the lease and the SDK reports got IP
+void gotIp()
+{
+    WiFi.connected = true;
+    WiFi.gotIpHandler(WiFiEventStationModeGotIP());
+}
+
+// first boot: connect with DHCP and save the lease
+void saveLease()
+{
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    manager.setStaOptions("Home", "secret");
+    manager.connect();
+    gotIp();
+    manager.loop();
+}
+
+bool requested(IPAddress address)
+{
+    return std::find(fakeArpRequests.begin(), fakeArpRequests.end(), uint32_t(address)) != fakeArpRequests.end();
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 1000;
+    SPIFFS = fs::FS();
+    WiFi = FakeWiFi();
+    WiFi.stationIP = leaseIp;
+    WiFi.stationGateway = leaseGateway;
+    WiFi.stationSubnet = leaseSubnet;
+    station.next = nullptr;
+    ip4_addr_set_u32(&station.ip_addr, uint32_t(leaseIp));
+    netif_list = &station;
+    fakeArpRequests.clear();
+    fakeArpTable.clear();
+}
+
+void tearDown()
+{
+    netif_list = nullptr;
+}
+
+void test_static_ip_is_configured_before_begin()
+{
+    ESPReactWifiManager manager;
+    manager.setStaticIp(IPAddress(10, 0, 0, 5), IPAddress(10, 0, 0, 1), IPAddress(255, 0, 0, 0));
+    manager.setStaOptions("Home", "secret");
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_UINT32(uint32_t(IPAddress(10, 0, 0, 5)), uint32_t(WiFi.configIP));
+    TEST_ASSERT_EQUAL_UINT32(uint32_t(IPAddress(10, 0, 0, 1)), uint32_t(WiFi.configGateway));
+    TEST_ASSERT_EQUAL_UINT32(uint32_t(IPAddress(255, 0, 0, 0)), uint32_t(WiFi.configSubnet));
+
+    // static address is not validated or saved as a lease
+    gotIp();
+    fakeMillis += 5000;
+    manager.loop();
+    TEST_ASSERT_TRUE(fakeArpRequests.empty());
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+}
+
+void test_lease_is_saved_from_loop()
+{
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    manager.setStaOptions("Home", "secret");
+    manager.connect();
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+
+    gotIp();
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+    manager.loop();
+    TEST_ASSERT_EQUAL(2, manager.credentialWrites());
+
+    // same lease on SDK reconnect is not written again
+    gotIp();
+    manager.loop();
+    TEST_ASSERT_EQUAL(2, manager.credentialWrites());
+}
+
+void test_lease_is_reused_when_gateway_answers()
+{
+    saveLease();
+    fakeArpTable.push_back(uint32_t(leaseGateway));
+
+    WiFi.configIP = IPAddress();
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    TEST_ASSERT_TRUE(manager.connect());
+    TEST_ASSERT_EQUAL_UINT32(uint32_t(leaseIp), uint32_t(WiFi.configIP));
+    TEST_ASSERT_EQUAL_UINT32(uint32_t(leaseGateway), uint32_t(WiFi.configGateway));
+
+    gotIp();
+    TEST_ASSERT_TRUE(requested(leaseGateway));
+    TEST_ASSERT_TRUE(requested(leaseIp));
+    uint32_t beginCount = WiFi.beginCount;
+    fakeMillis += gatewayCheckDelay + 1;
+    manager.loop();
+    TEST_ASSERT_EQUAL(beginCount, WiFi.beginCount);
+    TEST_ASSERT_EQUAL(0, manager.credentialWrites());
+}
+
+void test_lease_for_other_network_is_not_reused()
+{
+    saveLease();
+    WiFi.configIP = IPAddress();
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    manager.setStaOptions("Office", "secret");
+    manager.connect();
+    TEST_ASSERT_EQUAL_UINT32(0, uint32_t(WiFi.configIP));
+}
+
+void test_dhcp_fallback_when_gateway_is_silent()
+{
+    saveLease();
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    manager.connect();
+    gotIp();
+    uint32_t beginCount = WiFi.beginCount;
+
+    fakeMillis += gatewayCheckDelay + 1;
+    manager.loop();
+    // lease dropped and DHCP requested with a zero address
+    TEST_ASSERT_EQUAL(beginCount + 1, WiFi.beginCount);
+    TEST_ASSERT_EQUAL_UINT32(0, uint32_t(WiFi.configIP));
+    TEST_ASSERT_EQUAL(1, manager.credentialWrites());
+}
+
+void test_dhcp_fallback_when_address_is_taken()
+{
+    saveLease();
+    fakeArpTable.push_back(uint32_t(leaseGateway));
+    fakeArpTable.push_back(uint32_t(leaseIp));
+    ESPReactWifiManager manager;
+    manager.setLeaseReuse(true);
+    manager.connect();
+    gotIp();
+    uint32_t beginCount = WiFi.beginCount;
+
+    fakeMillis += gatewayCheckDelay + 1;
+    manager.loop();
+    TEST_ASSERT_EQUAL(beginCount + 1, WiFi.beginCount);
+    TEST_ASSERT_EQUAL_UINT32(0, uint32_t(WiFi.configIP));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_static_ip_is_configured_before_begin);
+    RUN_TEST(test_lease_is_saved_from_loop);
+    RUN_TEST(test_lease_is_reused_when_gateway_answers);
+    RUN_TEST(test_lease_for_other_network_is_not_reused);
+    RUN_TEST(test_dhcp_fallback_when_gateway_is_silent);
+    RUN_TEST(test_dhcp_fallback_when_address_is_taken);
+    return UNITY_END();
+}
@@ -0,0 +1,502 @@
+// Load test of the portal handlers on host: simulated clients share one
+// server loop like they do on the device, each gets one chunk per turn.
+// Load shape is set with build flags, e.g. -DLOAD_CLIENTS=32
+
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+#ifndef LOAD_CLIENTS
+#define LOAD_CLIENTS 8 // requests in flight at once
+#endif
+#ifndef LOAD_REQUESTS
+#define LOAD_REQUESTS 5000
+#endif
+#ifndef LOAD_NETWORKS
+#define LOAD_NETWORKS 30 // distinct ssids in the scan
+#endif
+#ifndef LOAD_CHUNK_SIZE
+#define LOAD_CHUNK_SIZE 536 // default lwIP TCP MSS
+#endif
+#ifndef LOAD_SCAN_EVERY
+#define LOAD_SCAN_EVERY 100 // requests between rescans, 0 - never
+#endif
+// request mix in percent, local not found gets the rest
+#ifndef LOAD_MIX_LIST
+#define LOAD_MIX_LIST 70
+#endif
+#ifndef LOAD_MIX_SAVE
+#define LOAD_MIX_SAVE 5
+#endif
+#ifndef LOAD_MIX_CAPTIVE
+#define LOAD_MIX_CAPTIVE 20
+#endif
+
+namespace {
+
+size_t heapUsed = 0;
+size_t heapPeak = 0;
+bool heapTracking = true; // off while the test itself allocates
+
+} // namespace
+
+// heap accounting for the peak report
+void* operator new(size_t size)
+{
+    void* block = malloc(sizeof(max_align_t) + size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    // size is kept in front of the block, zero if not counted
+    *static_cast<size_t*>(block) = heapTracking ? size : 0;
+    if (heapTracking) {
+        heapUsed += size;
+        heapPeak = std::max(heapPeak, heapUsed);
+    }
+    return static_cast<char*>(block) + sizeof(max_align_t);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (!pointer) {
+        return;
+    }
+    void* block = static_cast<char*>(pointer) - sizeof(max_align_t);
+    heapUsed -= *static_cast<size_t*>(block);
+    free(block);
+}
+
+namespace {
+
+const IPAddress stationIp(192, 168, 1, 50);
+const IPAddress apIp(8, 8, 8, 8);
+
+enum RequestKind {
+    RequestList,
+    RequestSave,
+    RequestCaptive,
+    RequestLocal,
+};
+
+struct RequestMix {
+    uint8_t list;
+    uint8_t save;
+    uint8_t captive;
+};
+
+struct LoadReport {
+    size_t requests;
+    double seconds;
+    double p50; // us
+    double p99; // us
+    size_t peakHeap; // bytes above the heap in use before the run
+};
+
+struct Client {
+    std::unique_ptr<AsyncWebServerRequest> request;
+    RequestKind kind;
+    String expected; // list as it was when the request came
+    size_t received;
+    bool valid;
+    std::chrono::steady_clock::time_point started;
+};
+
+AsyncWebServer* server = nullptr;
+ESPReactWifiManager* manager = nullptr;
+uint32_t localRequests = 0;
+uint32_t randomState = 1;
+
+uint32_t nextRandom()
+{
+    randomState = randomState * 1103515245 + 12345;
+    return (randomState >> 16) & 0x7fff;
+}
+
+void setNetworks(size_t count)
+{
+    WiFi.networks.clear();
+    for (size_t i = 0; i < count; i++) {
+        FakeNetwork network;
+        network.ssid = String((std::string("Network-") + std::to_string(i)).c_str());
+        network.encryptionType = i % 3 == 0 ? ENC_TYPE_NONE : ENC_TYPE_CCMP;
+        network.rssi = -30 - int32_t(i) * 2;
+        uint8_t bssid[6] = { 0x02, 0, 0, 0, uint8_t(i >> 8), uint8_t(i) };
+        memcpy(network.bssid, bssid, sizeof(bssid));
+        network.channel = 1 + i % 11;
+        network.isHidden = false;
+        WiFi.networks.push_back(network);
+    }
+    // hidden networks are scanned but not listed
+    FakeNetwork hidden = { String("Hidden"), ENC_TYPE_CCMP, -40, { 0x02, 0xff, 0, 0, 0, 0 }, 6, true };
+    WiFi.networks.push_back(hidden);
+}
+
+// signal changes between scans, order of the list changes with it
+void moveNetworks()
+{
+    for (FakeNetwork& network : WiFi.networks) {
+        network.rssi += int32_t(nextRandom() % 13) - 6;
+        network.rssi = std::max(-95, std::min(-20, network.rssi));
+    }
+}
+
+void rescan()
+{
+    fakeMillis += 1000;
+    manager->scan();
+}
+
+// results are kept between scans, expire them all
+void clearResults()
+{
+    WiFi.networks.clear();
+    fakeMillis += 1;
+    manager->setScanMaxAge(0);
+    manager->scan();
+    manager->setScanMaxAge(5 * 60 * 1000);
+}
+
+String expectedList()
+{
+    String json = "[";
+    ESPReactWifiManager::ResultsView view = manager->resultsView();
+    for (size_t i = 0; i < view.size(); i++) {
+        const ESPReactWifiManager::WifiResult& result = view[i];
+        json += i > 0 ? ",{\"ssid\":\"" : "{\"ssid\":\"";
+        json += result.ssid;
+        json += "\",\"signalStrength\":";
+        json += String(result.quality);
+        json += ",\"security\":\"";
+        json += result.encryptionType == ENC_TYPE_NONE ? "none" : "WEP";
+        json += "\"}";
+    }
+    json += "]";
+    return json;
+}
+
+AsyncWebServerRequest* newRequest(RequestKind kind)
+{
+    switch (kind) {
+    case RequestList:
+        return new AsyncWebServerRequest(HTTP_GET, "/wifiList", stationIp);
+    case RequestSave: {
+        AsyncWebServerRequest* request = new AsyncWebServerRequest(HTTP_POST, "/wifiSave", apIp);
+        request->addArg("ssid", "Network-1");
+        request->addArg("password", "secret");
+        return request;
+    }
+    case RequestCaptive:
+        return new AsyncWebServerRequest(HTTP_GET, "/generate_204", apIp);
+    case RequestLocal:
+    default:
+        return new AsyncWebServerRequest(HTTP_GET, "/index.html", stationIp);
+    }
+}
+
+AsyncWebServerRequest* handle(RequestKind kind)
+{
+    AsyncWebServerRequest* request = newRequest(kind);
+    server->handle(request);
+    return request;
+}
+
+String drain(AsyncWebServerRequest* request, size_t chunkSize)
+{
+    std::vector<uint8_t> buffer(chunkSize);
+    AsyncWebServerResponse* response = request->response();
+    while (!response->finished()) {
+        response->nextChunk(buffer.data(), buffer.size());
+    }
+    return response->content;
+}
+
+// list chunks are compared as they come, the test does not keep them
+void receiveChunk(Client& client, const uint8_t* buffer, size_t length)
+{
+    client.valid = client.valid && client.received + length <= client.expected.length()
+            && memcmp(client.expected.c_str() + client.received, buffer, length) == 0;
+    client.received += length;
+}
+
+bool responseValid(const Client& client)
+{
+    const AsyncWebServerResponse* response = client.request->response();
+    switch (client.kind) {
+    case RequestList:
+        return response->code == 200 && client.valid && client.received == client.expected.length();
+    case RequestSave:
+        return response->code == 200 && response->content.startsWith("Connect to: Network-1");
+    case RequestCaptive:
+        return response->code == 302 && response->location == "http://8.8.8.8/wifi.html";
+    case RequestLocal:
+    default:
+        return response->code == 200 && response->content == "local";
+    }
+}
+
+RequestKind pickKind(const RequestMix& mix)
+{
+    uint32_t value = nextRandom() % 100;
+    uint32_t save = mix.list + mix.save;
+    if (value < mix.list) {
+        return RequestList;
+    } else if (value < save) {
+        return RequestSave;
+    } else if (value < save + mix.captive) {
+        return RequestCaptive;
+    }
+    return RequestLocal;
+}
+
+LoadReport runLoad(size_t clientCount, size_t requestCount, const RequestMix& mix)
+{
+    std::vector<Client> clients(clientCount);
+    std::vector<uint64_t> latencies; // ns
+    latencies.reserve(requestCount);
+    std::vector<uint8_t> buffer(LOAD_CHUNK_SIZE);
+
+    size_t heapBefore = heapUsed;
+    heapPeak = heapUsed;
+    size_t issued = 0;
+    size_t invalid = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (latencies.size() < requestCount) {
+        for (Client& client : clients) {
+            if (!client.request) {
+                if (issued == requestCount) {
+                    continue;
+                }
+                if (LOAD_SCAN_EVERY > 0 && issued > 0 && issued % LOAD_SCAN_EVERY == 0) {
+                    moveNetworks();
+                    rescan();
+                }
+                ++issued;
+                client.kind = pickKind(mix);
+                heapTracking = false;
+                client.expected = client.kind == RequestList ? expectedList() : String();
+                heapTracking = true;
+                client.received = 0;
+                client.valid = true;
+                client.started = std::chrono::steady_clock::now();
+                client.request.reset(handle(client.kind));
+                client.request->response()->keepContent = false;
+            } else {
+                size_t length = client.request->response()->nextChunk(buffer.data(), buffer.size());
+                receiveChunk(client, buffer.data(), length);
+            }
+
+            if (client.request->response()->finished()) {
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - client.started).count());
+                if (!responseValid(client)) {
+                    ++invalid;
+                }
+                client.request.reset();
+            }
+        }
+    }
+
+    LoadReport report;
+    report.requests = latencies.size();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.peakHeap = heapPeak - heapBefore;
+    std::sort(latencies.begin(), latencies.end());
+    report.p50 = latencies[(latencies.size() - 1) * 50 / 100] / 1000.0;
+    report.p99 = latencies[(latencies.size() - 1) * 99 / 100] / 1000.0;
+    TEST_ASSERT_EQUAL_MESSAGE(0, invalid, "invalid responses under load");
+    return report;
+}
+
+void printReport(const char* name, size_t clientCount, const LoadReport& report)
+{
+    char message[200];
+    snprintf(message, sizeof(message),
+             "%s: %zu clients, %zu requests, %.0f req/s, p50 %.1f us, p99 %.1f us, peak heap %zu bytes",
+             name, clientCount, report.requests, report.requests / report.seconds,
+             report.p50, report.p99, report.peakHeap);
+    TEST_MESSAGE(message);
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 0;
+    randomState = 1;
+    localRequests = 0;
+    SPIFFS.files.clear();
+    WiFi = FakeWiFi();
+    WiFi.stationIP = stationIp;
+
+    server = new AsyncWebServer(80);
+    manager = new ESPReactWifiManager();
+    manager->onNotFound([](AsyncWebServerRequest* request) {
+        ++localRequests;
+        request->send(200, "text/html", "local");
+    });
+    manager->setupHandlers(server);
+    setNetworks(LOAD_NETWORKS);
+    rescan();
+}
+
+void tearDown()
+{
+    delete manager;
+    manager = nullptr;
+    delete server;
+    server = nullptr;
+}
+
+void test_wifi_list_matches_scan()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestList));
+    TEST_ASSERT_EQUAL(LOAD_NETWORKS, manager->resultCount());
+    TEST_ASSERT_EQUAL_STRING(expectedList().c_str(), drain(request.get(), LOAD_CHUNK_SIZE).c_str());
+    TEST_ASSERT_EQUAL(200, request->response()->code);
+}
+
+void test_wifi_list_empty()
+{
+    clearResults();
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestList));
+    TEST_ASSERT_EQUAL_STRING("[]", drain(request.get(), LOAD_CHUNK_SIZE).c_str());
+}
+
+void test_wifi_list_interleaved_clients_get_full_list()
+{
+    String expected = expectedList();
+    std::vector<std::unique_ptr<AsyncWebServerRequest>> requests;
+    for (size_t i = 0; i < LOAD_CLIENTS; i++) {
+        requests.emplace_back(handle(RequestList));
+    }
+    uint8_t buffer[LOAD_CHUNK_SIZE];
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (std::unique_ptr<AsyncWebServerRequest>& request : requests) {
+            if (!request->response()->finished()) {
+                request->response()->nextChunk(buffer, sizeof(buffer));
+                pending = true;
+            }
+        }
+    }
+    for (std::unique_ptr<AsyncWebServerRequest>& request : requests) {
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), request->response()->content.c_str());
+    }
+}
+
+void test_wifi_list_keeps_snapshot_across_scan()
+{
+    String expected = expectedList();
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestList));
+    uint8_t buffer[LOAD_CHUNK_SIZE];
+    request->response()->nextChunk(buffer, sizeof(buffer));
+    request->response()->nextChunk(buffer, sizeof(buffer));
+
+    setNetworks(3);
+    manager->setScanMaxAge(0);
+    rescan();
+    TEST_ASSERT_EQUAL(3, manager->resultCount());
+
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), drain(request.get(), LOAD_CHUNK_SIZE).c_str());
+}
+
+void test_wifi_list_small_buffer_is_not_overrun()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestList));
+    const size_t small = 16;
+    uint8_t buffer[small + 8];
+    memset(buffer, 0xa5, sizeof(buffer));
+    request->response()->nextChunk(buffer, small); // opening bracket
+    TEST_ASSERT_EQUAL(0, request->response()->nextChunk(buffer, small));
+    TEST_ASSERT_FALSE(request->response()->finished());
+    for (size_t i = small; i < sizeof(buffer); i++) {
+        TEST_ASSERT_EQUAL(0xa5, buffer[i]);
+    }
+    TEST_ASSERT_EQUAL_STRING(expectedList().c_str(), drain(request.get(), LOAD_CHUNK_SIZE).c_str());
+}
+
+void test_wifi_save_connects()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestSave));
+    TEST_ASSERT_EQUAL(200, request->response()->code);
+    TEST_ASSERT_EQUAL_STRING("Connect to: Network-1 after module reboot", request->response()->content.c_str());
+    TEST_ASSERT_EQUAL(1, WiFi.beginCount);
+    TEST_ASSERT_EQUAL_STRING("Network-1", WiFi.beginSsid.c_str());
+    TEST_ASSERT_EQUAL_STRING("secret", WiFi.beginPassphrase.c_str());
+    TEST_ASSERT_TRUE(manager->credentialsSaved());
+}
+
+void test_wifi_save_without_ssid()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(new AsyncWebServerRequest(HTTP_POST, "/wifiSave", apIp));
+    server->handle(request.get());
+    TEST_ASSERT_EQUAL_STRING("Wrong request. No ssid", request->response()->content.c_str());
+    TEST_ASSERT_EQUAL(0, WiFi.beginCount);
+}
+
+void test_captive_redirect()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestCaptive));
+    TEST_ASSERT_EQUAL(302, request->response()->code);
+    TEST_ASSERT_EQUAL_STRING("http://8.8.8.8/wifi.html", request->response()->location.c_str());
+    TEST_ASSERT_EQUAL(0, localRequests);
+}
+
+void test_local_not_found_callback()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(handle(RequestLocal));
+    TEST_ASSERT_EQUAL(200, request->response()->code);
+    TEST_ASSERT_EQUAL(1, localRequests);
+}
+
+void test_source_map_not_found()
+{
+    std::unique_ptr<AsyncWebServerRequest> request(new AsyncWebServerRequest(HTTP_GET, "/static/js/main.js.map", apIp));
+    server->handle(request.get());
+    TEST_ASSERT_EQUAL(404, request->response()->code);
+}
+
+void test_load_mixed()
+{
+    RequestMix mix = { LOAD_MIX_LIST, LOAD_MIX_SAVE, LOAD_MIX_CAPTIVE };
+    printReport("mixed", LOAD_CLIENTS, runLoad(LOAD_CLIENTS, LOAD_REQUESTS, mix));
+}
+
+void test_load_list_only()
+{
+    RequestMix mix = { 100, 0, 0 };
+    printReport("list, 1 client", 1, runLoad(1, LOAD_REQUESTS, mix));
+    printReport("list", LOAD_CLIENTS, runLoad(LOAD_CLIENTS, LOAD_REQUESTS, mix));
+    printReport("list", LOAD_CLIENTS * 4, runLoad(LOAD_CLIENTS * 4, LOAD_REQUESTS, mix));
+}
+
+void test_load_captive_only()
+{
+    RequestMix mix = { 0, 0, 100 };
+    printReport("captive", LOAD_CLIENTS, runLoad(LOAD_CLIENTS, LOAD_REQUESTS, mix));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wifi_list_matches_scan);
+    RUN_TEST(test_wifi_list_empty);
+    RUN_TEST(test_wifi_list_interleaved_clients_get_full_list);
+    RUN_TEST(test_wifi_list_keeps_snapshot_across_scan);
+    RUN_TEST(test_wifi_list_small_buffer_is_not_overrun);
+    RUN_TEST(test_wifi_save_connects);
+    RUN_TEST(test_wifi_save_without_ssid);
+    RUN_TEST(test_captive_redirect);
+    RUN_TEST(test_local_not_found_callback);
+    RUN_TEST(test_source_map_not_found);
+    RUN_TEST(test_load_mixed);
+    RUN_TEST(test_load_list_only);
+    RUN_TEST(test_load_captive_only);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+// Cost of reading scan results with 50 networks: the results() copy that
+// callers used before against resultsView() and forEachResult().
+
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+#include <chrono>
+#include <new>
+
+#ifndef BENCH_NETWORKS
+#define BENCH_NETWORKS 50
+#endif
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 20000
+#endif
+
+namespace {
+
+size_t allocations = 0;
+size_t allocatedBytes = 0;
+
+} // namespace
+
+// out of line, inlined into a free() gcc reports a mismatched delete
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    ++allocations;
+    allocatedBytes += size;
+    void* block = malloc(size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+namespace {
+
+struct BenchResult {
+    double nsPerCall;
+    double allocationsPerCall;
+    double bytesPerCall;
+};
+
+ESPReactWifiManager* manager = nullptr;
+volatile int32_t sink = 0; // keeps the loops from being optimized away
+
+template<typename Func>
+BenchResult bench(Func func)
+{
+    size_t allocationsBefore = allocations;
+    size_t bytesBefore = allocatedBytes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_ITERATIONS; i++) {
+        func();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    BenchResult result;
+    result.nsPerCall = ns / BENCH_ITERATIONS;
+    result.allocationsPerCall = double(allocations - allocationsBefore) / BENCH_ITERATIONS;
+    result.bytesPerCall = double(allocatedBytes - bytesBefore) / BENCH_ITERATIONS;
+    return result;
+}
+
+void printResult(const char* name, const BenchResult& result)
+{
+    char message[160];
+    snprintf(message, sizeof(message), "%s: %.1f ns, %.1f allocations, %.0f bytes per call",
+             name, result.nsPerCall, result.allocationsPerCall, result.bytesPerCall);
+    TEST_MESSAGE(message);
+}
+
+// sums signal of every network, what a status page does per refresh
+void readCopy()
+{
+    int32_t sum = 0;
+    for (const ESPReactWifiManager::WifiResult& result : manager->results()) {
+        sum += result.rssi;
+    }
+    sink = sum;
+}
+
+void readView()
+{
+    int32_t sum = 0;
+    for (const ESPReactWifiManager::WifiResult& result : manager->resultsView()) {
+        sum += result.rssi;
+    }
+    sink = sum;
+}
+
+void readForEach()
+{
+    int32_t sum = 0;
+    manager->forEachResult([&sum](const ESPReactWifiManager::WifiResult& result) {
+        sum += result.rssi;
+    });
+    sink = sum;
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 0;
+    WiFi = FakeWiFi();
+    WiFi.networks.clear();
+    for (size_t i = 0; i < BENCH_NETWORKS; i++) {
+        FakeNetwork network;
+        network.ssid = String((std::string("Benchmark network ") + std::to_string(i)).c_str());
+        network.encryptionType = ENC_TYPE_CCMP;
+        network.rssi = -30 - int32_t(i);
+        uint8_t bssid[6] = { 0x02, 0, 0, 0, uint8_t(i >> 8), uint8_t(i) };
+        memcpy(network.bssid, bssid, sizeof(bssid));
+        network.channel = 1 + i % 11;
+        network.isHidden = false;
+        WiFi.networks.push_back(network);
+    }
+    manager = new ESPReactWifiManager();
+    fakeMillis += 1000;
+    manager->scan();
+}
+
+void tearDown()
+{
+    delete manager;
+    manager = nullptr;
+}
+
+void test_results_are_equal()
+{
+    std::vector<ESPReactWifiManager::WifiResult> copy = manager->results();
+    ESPReactWifiManager::ResultsView view = manager->resultsView();
+    TEST_ASSERT_EQUAL(BENCH_NETWORKS, copy.size());
+    TEST_ASSERT_EQUAL(copy.size(), view.size());
+    size_t index = 0;
+    manager->forEachResult([&](const ESPReactWifiManager::WifiResult& result) {
+        TEST_ASSERT_EQUAL_STRING(copy[index].ssid.c_str(), view[index].ssid.c_str());
+        TEST_ASSERT_EQUAL_STRING(copy[index].ssid.c_str(), result.ssid.c_str());
+        ++index;
+    });
+    TEST_ASSERT_EQUAL(copy.size(), index);
+}
+
+void test_bench_read_results()
+{
+    BenchResult copy = bench(readCopy);
+    BenchResult view = bench(readView);
+    BenchResult forEach = bench(readForEach);
+    printResult("results() copy", copy);
+    printResult("resultsView()", view);
+    printResult("forEachResult()", forEach);
+
+    // the copy allocates the vector and every ssid, the view and forEachResult() nothing
+    TEST_ASSERT_TRUE(copy.allocationsPerCall >= BENCH_NETWORKS);
+    TEST_ASSERT_TRUE(view.allocationsPerCall == 0);
+    TEST_ASSERT_TRUE(forEach.allocationsPerCall == 0);
+    TEST_ASSERT_TRUE(view.nsPerCall < copy.nsPerCall);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_results_are_equal);
+    RUN_TEST(test_bench_read_results);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include <FakePlatform.h>
+#include <ESPReactWifiManager.cpp>
+#include <unity.h>
+
+namespace {
+
+// one result per access point, so the table entries are visible in results
+struct PerBssidConfig : ESPReactWifiManagerConfig {
+    static constexpr bool scanDedup = false;
+    static constexpr bool logging = false;
+};
+
+typedef BasicESPReactWifiManager<PerBssidConfig> WifiManager;
+
+void addNetwork(const char* ssid, uint8_t id, int32_t channel, int32_t rssi)
+{
+    FakeNetwork network = { String(ssid), ENC_TYPE_CCMP, rssi, { 0x02, 0, 0, 0, 0, id }, channel, false };
+    WiFi.networks.push_back(network);
+}
+
+// 0 if the access point is not listed
+int32_t rssiOf(WifiManager& manager, uint8_t id)
+{
+    for (const ESPReactWifiManagerCore::WifiResult& result : manager.resultsView()) {
+        if (result.bssid[5] == id) {
+            return result.rssi;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+void setUp()
+{
+    fakeMillis = 1000;
+    SPIFFS = fs::FS();
+    WiFi = FakeWiFi();
+}
+
+void tearDown()
+{
+}
+
+void test_same_bssid_is_merged()
+{
+    addNetwork("Home", 1, 1, -60);
+    addNetwork("Home", 2, 6, -70);
+    WifiManager manager;
+    manager.scan();
+    manager.scan();
+    TEST_ASSERT_EQUAL(2, manager.resultCount());
+
+    // renamed access point keeps its entry
+    WiFi.networks[0].ssid = "Renamed";
+    manager.scan();
+    TEST_ASSERT_EQUAL(2, manager.resultCount());
+    TEST_ASSERT_EQUAL_STRING("Renamed", manager.resultsView()[0].ssid.c_str());
+}
+
+void test_rssi_converges_to_steady_reading()
+{
+    addNetwork("Home", 1, 1, -80);
+    WifiManager manager;
+    manager.scan();
+    TEST_ASSERT_EQUAL(-80, manager.resultsView()[0].rssi);
+
+    WiFi.networks[0].rssi = -40;
+    manager.scan();
+    int32_t rssi = manager.resultsView()[0].rssi;
+    TEST_ASSERT_TRUE(rssi < -40 && rssi > -80);
+
+    for (int i = 0; i < 30; i++) {
+        manager.scan();
+    }
+    TEST_ASSERT_EQUAL(-40, manager.resultsView()[0].rssi);
+}
+
+void test_single_noisy_reading_is_damped()
+{
+    addNetwork("Home", 1, 1, -50);
+    WifiManager manager;
+    manager.scan();
+    WiFi.networks[0].rssi = -90;
+    manager.scan();
+    TEST_ASSERT_EQUAL(-60, manager.resultsView()[0].rssi);
+}
+
+void test_entries_expire_after_max_age()
+{
+    addNetwork("Home", 1, 1, -60);
+    addNetwork("Office", 2, 6, -70);
+    WifiManager manager;
+    manager.setScanMaxAge(10000);
+    manager.scan();
+
+    WiFi.networks.pop_back();
+    fakeMillis += 6000;
+    manager.scan();
+    TEST_ASSERT_EQUAL(2, manager.resultCount());
+
+    fakeMillis += 6000;
+    manager.scan();
+    TEST_ASSERT_EQUAL(1, manager.resultCount());
+    TEST_ASSERT_EQUAL(0, rssiOf(manager, 2));
+}
+
+void test_channel_scan_keeps_other_channels()
+{
+    addNetwork("Home", 1, 1, -60);
+    addNetwork("Office", 2, 6, -70);
+    WifiManager manager;
+    manager.scan();
+
+    WiFi.networks[0].rssi = -64;
+    WiFi.networks[1].rssi = -30;
+    manager.scan(1);
+    TEST_ASSERT_EQUAL(2, manager.resultCount());
+    TEST_ASSERT_EQUAL(-61, rssiOf(manager, 1));
+    // not scanned, old reading kept
+    TEST_ASSERT_EQUAL(-70, rssiOf(manager, 2));
+}
+
+void test_generation_changes_only_with_order()
+{
+    addNetwork("Home", 1, 1, -50);
+    addNetwork("Office", 2, 6, -70);
+    WifiManager manager;
+    manager.scan();
+    uint32_t generation = manager.generation();
+
+    // same order, different signal
+    WiFi.networks[0].rssi = -55;
+    manager.scan();
+    TEST_ASSERT_EQUAL(generation, manager.generation());
+
+    // Office overtakes Home
+    WiFi.networks[1].rssi = -20;
+    for (int i = 0; i < 3; i++) {
+        manager.scan();
+    }
+    TEST_ASSERT_EQUAL_STRING("Office", manager.resultsView()[0].ssid.c_str());
+    TEST_ASSERT_EQUAL(generation + 1, manager.generation());
+
+    addNetwork("Cafe", 3, 11, -90);
+    manager.scan();
+    TEST_ASSERT_EQUAL(generation + 2, manager.generation());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_same_bssid_is_merged);
+    RUN_TEST(test_rssi_converges_to_steady_reading);
+    RUN_TEST(test_single_noisy_reading_is_damped);
+    RUN_TEST(test_entries_expire_after_max_age);
+    RUN_TEST(test_channel_scan_keeps_other_channels);
+    RUN_TEST(test_generation_changes_only_with_order);
+    return UNITY_END();
+}